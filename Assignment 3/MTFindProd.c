@@ -9,27 +9,119 @@ Dedicated VM CPU: 13th Gen Intel(R) Core(TM) i9-13900KF CPU at 3.00GHz, 8 physic
 ECS Systems CPU: Intel(R) Xeon(R) Gold 6254 CPU at 3.10GHz, 4 logical processors, VM
 */
 
+#define _GNU_SOURCE // pthread_setaffinity_np for the pinned pool workers
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
-#include <sys/timeb.h>
 #include <semaphore.h>
 #include <stdbool.h> 
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <stdarg.h>
+#include <linux/perf_event.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 
 #define MAX_SIZE 100000000
 #define MAX_THREADS 16
 #define RANDOM_SEED 7649
 #define MAX_RANDOM_NUMBER 3000
 #define NUM_LIMIT 9973
+#define DEFAULT_CHUNK_SIZE 65536 // Elements per chunk in --schedule=chunked, 256 KB of ints: fits in L2 with room to spare
+#define CACHE_LINE 64
+#define SHARING_BENCH_BLOCK 256 // Elements between progress stores in --sharing-bench, small so the stores are frequent
+#define SHARING_BENCH_RUNS 5
+#define DEFAULT_POOL_QUERIES 1000 // Random range queries answered by the pool phase, --queries=N
+#define POOL_QUERY_MAX_LEN 65536 // Longest random query, short enough that dispatch is a visible part of the cost
+#define PROD_POOL_MAX MAX_THREADS
+#define PERF_COUNTERS 3 // Cycles, instructions and last-level cache misses per thread with --perf
+
+#include "prod_kernels.h"
+#include "prod_pool.h"
+#include "prod_index.h"
+#include "prod_file.h"
+#include "../common/fast_rand.h" // xoshiro256** streams for the input, shared with Assignment1
 
 // Global variables
-long gRefTime; //For timing
-int gData[MAX_SIZE]; //The array that will hold the data
+long long gRefTime; //For timing, CLOCK_MONOTONIC nanoseconds at SetTime()
+// How each element of gData is stored
+typedef enum {
+    STORAGE_INT,        // 32-bit int per element, as the assignment specifies (default)
+    STORAGE_UINT16      // 16-bit per element: values never exceed MAX_RANDOM_NUMBER, so this halves the bytes every scan reads
+} StorageMode;
+
+ProdArray gData; //The array that will hold the data, arraySize elements mapped by AllocateData; gData.i32 or gData.u16 by gStorage
+StorageMode gStorage = STORAGE_INT;
+const char *gInputPath; //--input=file: multiply the elements of this file instead of generating gData
+bool gInputMmap; //--io=mmap: read --input through a mapping instead of double-buffered pread
+const char *gSavePath; //--save-input=file: write the generated gData out in the same format --input reads
+size_t gDataBytes; //Length of the gData mapping
+bool gHugePages; //--huge-pages: back gData with 2 MB pages
+bool gInterleave; //--interleave: spread the pages of gData over every NUMA node
 
 int gThreadCount; //Number of threads
 int gDoneThreadCount; //Number of threads that are done at a certain point. Whenever a thread is done, it increments this. Used with the semaphore-based solution
-int gThreadProd[MAX_THREADS]; //The modular product for each array division that a single thread is responsible for
-bool gThreadDone[MAX_THREADS]; //Is this thread done? Used when the parent is continually checking on child threads
+// One result slot per thread, each starting on its own cache line: a worker publishing its result never invalidates the line the parent is polling for another thread
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_int product; //The modular product for the array division (or chunks) the thread is responsible for
+    atomic_bool done; //Is this thread done? Used when the parent is continually checking on child threads
+    long long startNs, finishNs; //When the thread began and finished its share, written by the thread and read by the parent after the join
+    long long elements; //Elements the thread multiplied, fewer than its division if a zero stopped it
+    int perfFd[PERF_COUNTERS]; //--perf counters of this thread, -1 if not open
+    long long counters[PERF_COUNTERS]; //Their values at finish, -1 if not measured
+} ThreadResult;
+
+ThreadResult gThreadResult[MAX_THREADS];
+
+// How the threaded variants split gData
+typedef enum {
+    SCHEDULE_STATIC,    // One contiguous division per thread from CalculateIndices (default)
+    SCHEDULE_CHUNKED    // Threads take fixed-size chunks from a shared atomic cursor until none are left
+} ScheduleMode;
+
+int gArraySize; //Number of elements in gData
+ScheduleMode gSchedule = SCHEDULE_STATIC;
+int gChunkSize = DEFAULT_CHUNK_SIZE;
+atomic_int gNextChunk; //Index of the next chunk nobody has taken yet, reset by InitSharedVars
+bool gSharingBench; //--sharing-bench: compare the packed and padded result layouts, then exit
+int gPoolQueries = DEFAULT_POOL_QUERIES; //Random range queries for the persistent pool phase
+int gRepeat; //--repeat=N: run the sequential and threaded variants N times and print only a JSON summary, 0 for a normal run
+bool gPerf; //--perf: count cycles, instructions and cache misses in every worker through perf_event_open
+
+// Cooperative early exit: every worker checks gZeroFound between blocks, whoever multiplies in a zero sets it
+atomic_bool gZeroFound;
+atomic_llong gZeroFoundNs; //CLOCK_MONOTONIC time the first zero was found, 0 if none yet
+pthread_mutex_t gDoneLock = PTHREAD_MUTEX_INITIALIZER; //Protects gWorkersDone
+pthread_cond_t gDoneCond = PTHREAD_COND_INITIALIZER; //Signalled when a worker finishes or finds a zero
+int gWorkersDone; //Workers of the cooperative variant that have stored their product
+
+// The variants a --repeat summary covers, in the order main runs them
+typedef enum {
+    VARIANT_SEQUENTIAL,
+    VARIANT_PARENT_WAITING,
+    VARIANT_BUSY_WAITING,
+    VARIANT_SEMAPHORE,
+    VARIANT_COOPERATIVE,
+    VARIANT_COUNT
+} Variant;
+
+const char *gVariantNames[VARIANT_COUNT] = { "sequential", "parent_waiting", "busy_waiting", "semaphore", "cooperative" };
+
+// One run of one variant, copied out of gThreadResult before the next variant resets it
+typedef struct {
+    double ms;
+    int product;
+    double startMs[MAX_THREADS]; //Thread start after SetTime(), the cost of getting it going
+    double busyMs[MAX_THREADS]; //Finish minus start
+    long long elements[MAX_THREADS];
+    long long counters[MAX_THREADS][PERF_COUNTERS];
+} RunRecord;
+
+RunRecord *gRuns; //VARIANT_COUNT records per run, allocated on the first RecordRun of a --repeat
+
 
 // Semaphores
 sem_t completed; //To notify parent that all threads have completed or one of them found a zero
@@ -42,25 +134,43 @@ int ComputeTotalProduct(); // Multiply the division products to compute the tota
 void InitSharedVars();
 void GenerateInput(int size, int indexForZero); //Generate the input array
 void CalculateIndices(int arraySize, int thrdCnt, int indices[MAX_THREADS][3]); //Calculate the indices to divide the array into T divisions, one division per thread
-int GetRand(int min, int max);//Get a random number between min and max
+void *ThGenerateInput(void *param); //Fill one division of gData from its own stream
+int ParseOption(const char *arg); //Handle one --option after the three positional arguments, 0 if valid
+int ThreadProd(int start, int end, long long *elements); //Product of a thread's share of gData: its division, or the chunks it manages to take
+void *ThFindProdCooperative(void *param); //Thread FindProduct that wakes the parent through gDoneCond
+long long GetNanoTime(void); //CLOCK_MONOTONIC in nanoseconds
+void AllocateData(int size); //Map gData for size elements, without touching it
+void FreeData(void);
+void FileProd(void); //Product of the --input file through the pool, with the read rate
+void SaveInput(int size); //Write gData[0..size-1] to --save-input
+void Report(const char *format, ...); //printf, except in --repeat mode where only the JSON summary is printed
+int PerfOpen(int c); //Open --perf counter c for the calling thread, -1 if that is not allowed
+void ThreadBegin(int threadNum); //Record the start of a worker and open its counters
+void ThreadEnd(int threadNum, long long elements); //Record the finish of a worker and read its counters
+void RecordRun(int variant, int run, double ms, int prod); //Keep one variant's timing and per-thread records for the summary
+void ReportThreads(void); //One line of per-thread balance for the variant that just ran
+void PrintRepeatJson(int arraySize); //--repeat summary: min/median/max per variant and thread imbalance
+void SharingBench(int indices[MAX_THREADS][3]); //Time workers publishing into packed and into padded result slots
+void RunVariants(int run, int arraySize, int indices[MAX_THREADS][3]); //The sequential and threaded variants once, recorded as run of --repeat
+void *ThSharingBench(void *param); //Worker for SharingBench, stores its running product after every block
 
 //Timing functions
-long GetMilliSecondTime(struct timeb timeBuf);
-long GetCurrentTime(void);
 void SetTime(void);
-long GetTime(void);
+double GetTime(void); //Milliseconds since SetTime(), with nanosecond resolution
 
 int main(int argc, char *argv[]){
 
-	pthread_t tid[MAX_THREADS];
-	pthread_attr_t attr[MAX_THREADS];
 	int indices[MAX_THREADS][3];
-    int params[MAX_THREADS][3]; // Parameters for each thread
 	int i, indexForZero, arraySize, prod;
 
 	// Code for parsing and checking command-line arguments
-	if (argc != 4) {
+	if (argc < 4) {
         fprintf(stderr, "Invalid number of arguments!\n");
+        fprintf(stderr, "Usage: %s <arraySize> <threadCount> <indexForZero> [--kernel=auto|avx512|avx2|barrett|scalar]\n"
+                        "       [--schedule=static|chunked] [--chunk=N] [--queries=N] [--sharing-bench]\n"
+                        "       [--huge-pages] [--interleave] [--storage=int|uint16]\n"
+                        "       [--input=file [--io=pread|mmap]] [--save-input=file]\n"
+                        "       [--repeat=N] [--perf]\n", argv[0]);
         exit(-1);
     }
 	if((arraySize = atoi(argv[1])) <= 0 || arraySize > MAX_SIZE){
@@ -77,14 +187,210 @@ int main(int argc, char *argv[]){
 		fprintf(stderr, "Invalid index for zero!\n");
 		exit(-1);
 	}
+	if (ProdSelectKernel("auto") != 0) {
+		exit(-1);
+	}
+	for (i = 4; i < argc; i++) {
+		if (ParseOption(argv[i]) != 0) {
+			exit(-1);
+		}
+	}
+	gArraySize = arraySize;
+	if (gPerf) {
+		int fd = PerfOpen(0);
+		if (fd < 0) {
+			perror("Hardware counters are not available, continuing without --perf");
+			gPerf = false;
+		} else {
+			close(fd);
+		}
+	}
+	Report("Using the %s product kernel\n", gProdKernelName);
+	if (gSchedule == SCHEDULE_CHUNKED) {
+		Report("Threads take chunks of %d elements from a shared cursor\n", gChunkSize);
+	}
+
+	if (gInputPath != NULL) {
+		FileProd();
+		return 0;
+	}
 
+    AllocateData(arraySize);
     GenerateInput(arraySize, indexForZero);
+	if (gSavePath != NULL) {
+		SaveInput(arraySize);
+	}
     CalculateIndices(arraySize, gThreadCount, indices);
+	if (gSharingBench) {
+		SharingBench(indices);
+		FreeData();
+		return 0;
+	}
+
+	for (int run = 0; run < (gRepeat > 0 ? gRepeat : 1); run++) {
+		RunVariants(run, arraySize, indices);
+	}
+	if (gRepeat > 0) {
+		PrintRepeatJson(arraySize);
+		FreeData();
+		return 0;
+	}
+
+
+
+	/*************** START OF PERSISTENT THREAD POOL ***************/
+	/*
+		Persistent Thread Pool:
+			* The workers of prod_pool.h are created and pinned once, then answer any number of range queries over gData
+			* First the whole array, to compare with the variants above; the pool splits a range the same way CalculateIndices does
+			* Then gPoolQueries random ranges of up to POOL_QUERY_MAX_LEN elements, each checked against ProdRange on this thread
+			     -The same ranges are then answered by a pool created and destroyed per query, which is what the variants above pay
+	*/
+	printf("\nSTART OF PERSISTENT THREAD POOL: \n");
+
+	ProdPool pool;
+	if (ProdPoolInit(&pool, gData, gThreadCount) != 0) {
+		exit(1);
+	}
+	SetTime();
+	prod = ProdPoolQuery(&pool, 0, arraySize - 1);
+	printf("Persistent pool multiplication completed in %.3f ms. Product = %d\n", GetTime(), prod);
+
+	if (gPoolQueries > 0) {
+		RandState queryRng;
+		long long poolNs = 0, spawnNs = 0;
+		int maxLen = arraySize < POOL_QUERY_MAX_LEN ? arraySize : POOL_QUERY_MAX_LEN;
+
+		RandSeed(&queryRng, RANDOM_SEED + 1);
+		for (i = 0; i < gPoolQueries; i++) {
+			int len = RandRange(&queryRng, 1, maxLen);
+			int first = RandRange(&queryRng, 0, arraySize - len);
+
+			long long start = GetNanoTime();
+			int poolProd = ProdPoolQuery(&pool, first, first + len - 1);
+			long long mid = GetNanoTime();
+			ProdPool once;
+			if (ProdPoolInit(&once, gData, gThreadCount) != 0) {
+				exit(1);
+			}
+			int spawnProd = ProdPoolQuery(&once, first, first + len - 1);
+			ProdPoolDestroy(&once);
+			spawnNs += GetNanoTime() - mid;
+			poolNs += mid - start;
+
+			if (poolProd != ProdRange(gData, first, first + len - 1) || spawnProd != poolProd) {
+				fprintf(stderr, "Pool query [%d, %d] returned the wrong product\n", first, first + len - 1);
+				exit(1);
+			}
+		}
+		printf("%d range queries of up to %d elements: %.1f us each on the pool, %.1f us each creating the threads per query\n",
+		       gPoolQueries, maxLen, poolNs / 1000.0 / gPoolQueries, spawnNs / 1000.0 / gPoolQueries);
+	}
+	ProdPoolDestroy(&pool);
+
+	/*************** END OF PERSISTENT THREAD POOL ***************/
+
+
+
+	/*************** START OF RANGE PRODUCT INDEX ***************/
+	/*
+		Range Product Index:
+			* prod_index.h builds a segment tree of block products once, after which a range costs O(log n) instead of a scan
+			* The same gPoolQueries random ranges as the pool phase are answered from the index and checked against ProdRange
+			* Then as many point updates: a random element gets a new random value, and every few updates an element is set
+			  to zero and back, each followed by a query over the whole array checked against a full scan every 100 updates
+			     -gData is left modified, which is why this phase runs last
+	*/
+	printf("\nSTART OF RANGE PRODUCT INDEX: \n");
+
+	ProdIndex index;
+	SetTime();
+	if (ProdIndexBuild(&index, gData, arraySize) != 0) {
+		exit(1);
+	}
+	printf("Index built in %.3f ms over %ld blocks of %d elements\n", GetTime(), ((long) arraySize + PROD_INDEX_BLOCK - 1) / PROD_INDEX_BLOCK,
+	       PROD_INDEX_BLOCK);
+	prod = ProdIndexQuery(&index, 0, arraySize - 1);
+	printf("Index product of the whole array = %d\n", prod);
+
+	if (gPoolQueries > 0) {
+		RandState queryRng;
+		long long queryNs = 0, updateNs = 0;
+
+		RandSeed(&queryRng, RANDOM_SEED + 1);							// Same ranges as the pool phase
+		for (i = 0; i < gPoolQueries; i++) {
+			int len = RandRange(&queryRng, 1, arraySize < POOL_QUERY_MAX_LEN ? arraySize : POOL_QUERY_MAX_LEN);
+			int first = RandRange(&queryRng, 0, arraySize - len);
+
+			long long start = GetNanoTime();
+			int indexProd = ProdIndexQuery(&index, first, first + len - 1);
+			queryNs += GetNanoTime() - start;
+			if (indexProd != ProdRange(gData, first, first + len - 1)) {
+				fprintf(stderr, "Index query [%d, %d] returned the wrong product\n", first, first + len - 1);
+				exit(1);
+			}
+		}
+
+		for (i = 0; i < gPoolQueries; i++) {
+			int pos = RandRange(&queryRng, 0, arraySize - 1);
+			int old = (int) ProdElem(gData, pos);
+
+			long long start = GetNanoTime();
+			if (i % 10 == 0) {
+				ProdIndexUpdate(&index, pos, 0);
+				if (ProdIndexQuery(&index, 0, arraySize - 1) != 0) {
+					fprintf(stderr, "Index missed the zero written at %d\n", pos);
+					exit(1);
+				}
+				ProdIndexUpdate(&index, pos, old);
+			} else {
+				ProdIndexUpdate(&index, pos, RandRange(&queryRng, 1, MAX_RANDOM_NUMBER));
+			}
+			int indexProd = ProdIndexQuery(&index, 0, arraySize - 1);
+			updateNs += GetNanoTime() - start;
+			if (i % 100 == 0 && indexProd != ProdRange(gData, 0, arraySize - 1)) {
+				fprintf(stderr, "Index product after updating %d is wrong\n", pos);
+				exit(1);
+			}
+		}
+		printf("%d range queries: %.2f us each, %d point updates with a whole-array query: %.2f us each\n",
+		       gPoolQueries, queryNs / 1000.0 / gPoolQueries, gPoolQueries, updateNs / 1000.0 / gPoolQueries);
+	}
+	ProdIndexFree(&index);
+
+	/*************** END OF RANGE PRODUCT INDEX ***************/
+
+
+
+	// Exit the program
+	FreeData();
+    exit(0);
+}
+
+
+
+
+
+/*************** START OF VARIANTS ***************/
+/*
+	Variants:
+		* The sequential and the four threaded variants, called once from main, or gRepeat times with --repeat
+		* Each run is recorded by RecordRun, and with --repeat only the JSON summary of all runs is printed at the end
+*/
+void RunVariants(int run, int arraySize, int indices[MAX_THREADS][3]) {
+
+	pthread_t tid[MAX_THREADS];
+	pthread_attr_t attr[MAX_THREADS];
+    int params[MAX_THREADS][3]; // Parameters for each thread
+	int i, prod;
+	double ms;
 
 	// Code for the sequential part
 	SetTime();
 	prod = SqFindProd(arraySize);
-	printf("Sequential multiplication completed in %ld ms. Product = %d\n", GetTime(), prod);
+	ms = GetTime();
+	Report("Sequential multiplication completed in %.3f ms. Product = %d\n", ms, prod);
+	RecordRun(VARIANT_SEQUENTIAL, run, ms, prod);
 
 	// Threaded with parent waiting for all child threads
 	InitSharedVars();
@@ -103,7 +409,7 @@ int main(int argc, char *argv[]){
 			* This approach ensures that shared variables are properly managed across multiple threads.
 			* Thread attributes are safely destroyed after all threads complete, to clean up allocated resources.
 	*/
-	printf("\nSTART OF PARENT WAITING AND THREAD MANAGEMENT: \n");
+	Report("\nSTART OF PARENT WAITING AND THREAD MANAGEMENT: \n");
 
 	// Initialize and create threads
     for (i = 0; i < gThreadCount; i++) {
@@ -126,7 +432,10 @@ int main(int argc, char *argv[]){
 
 
 	prod = ComputeTotalProduct();
-	printf("Threaded multiplication with parent waiting for all children completed in %ld ms. Product = %d\n", GetTime(), prod);
+	ms = GetTime();
+	Report("Threaded multiplication with parent waiting for all children completed in %.3f ms. Product = %d\n", ms, prod);
+	ReportThreads();
+	RecordRun(VARIANT_PARENT_WAITING, run, ms, prod);
 
 
 	// Multi-threaded with busy waiting (parent continually checking on child threads without using semaphores)
@@ -143,7 +452,7 @@ int main(int argc, char *argv[]){
 		* If a zero is detected, exit the monitoring loop immediately to halt further processing.
 		* Cancel and join all threads ensuring no resources are left hanging, providing a clean exit and memory management.
 	*/
-	printf("\nSTART OF BUSY WAITING AND THREAD MANAGEMENT: \n");
+	Report("\nSTART OF BUSY WAITING AND THREAD MANAGEMENT: \n");
 
 	volatile bool all_done = false;                // Flag to check if all threads have completed
 	bool found_zero = false;                       // Flag to indicate if zero product is found
@@ -154,19 +463,19 @@ int main(int argc, char *argv[]){
 			fprintf(stderr, "Error creating thread %d\n", i);
 			exit(1);
 		}
-		// FOR DEBUGGING printf("Thread %d started\n", i);
+		// FOR DEBUGGING Report("Thread %d started\n", i);
 	}
 
 	// Busy waiting loop to monitor threads
 	do {
 		all_done = true; 														// Assume all threads are completed unless found otherwise
 		for (i = 0; i < gThreadCount; i++) {
-			if (!gThreadDone[i]) {
+			if (!atomic_load_explicit(&gThreadResult[i].done, memory_order_acquire)) {
 				all_done = false;  												// One or more threads are still processing
-																				// FOR DEBUGGING printf("Checking thread %d: still active\n", i);
-				if (gThreadProd[i] == 0) {
+																				// FOR DEBUGGING Report("Checking thread %d: still active\n", i);
+				if (atomic_load_explicit(&gThreadResult[i].product, memory_order_relaxed) == 0) {
 					found_zero = true;  // Zero product found
-																				// FOR DEBUGGING printf("Zero product detected by thread %d\n", i);
+																				// FOR DEBUGGING Report("Zero product detected by thread %d\n", i);
 					break;  													// Break the inner loop if zero is found
 				}
 			}
@@ -179,21 +488,22 @@ int main(int argc, char *argv[]){
 	if (found_zero || all_done) {
 		for (i = 0; i < gThreadCount; i++) {
 			pthread_cancel(tid[i]);  											// Cancel and join all threads if zero is detected or all are done
-																				// FOR DEBUGGING printf("Cancelling thread %d\n", i);
+																				// FOR DEBUGGING Report("Cancelling thread %d\n", i);
 		}
 		for (i = 0; i < gThreadCount; i++) {
 			pthread_join(tid[i], NULL);  // Wait for each thread to terminate
-																				// FOR DEBUGGING printf("Thread %d joined\n", i);
+																				// FOR DEBUGGING Report("Thread %d joined\n", i);
 		}
 	}
 
 																				// Calculate the total product if no zero was found
-	if (!found_zero) {
-		int totalProduct = ComputeTotalProduct();
-																				// FOR DEBUGGING printf("Total product computed: %d\n", totalProduct);
-	}
+	prod = found_zero ? 0 : ComputeTotalProduct();
+																				// FOR DEBUGGING Report("Total product computed: %d\n", prod);
 
-	printf("Threaded multiplication with busy waiting completed in %ld ms. Product = %d\n", GetTime(), prod);
+	ms = GetTime();
+	Report("Threaded multiplication with busy waiting completed in %.3f ms. Product = %d\n", ms, prod);
+	ReportThreads();
+	RecordRun(VARIANT_BUSY_WAITING, run, ms, prod);
 /*************** END OF BUSY WAITING AND THREAD MANAGEMENT ***************/
 
 
@@ -219,7 +529,7 @@ int main(int argc, char *argv[]){
 */
 
 
-printf("\nSTART OF SEMAPHORE SYNCHRONIZATION AND THREAD MANAGEMENT: \n");
+Report("\nSTART OF SEMAPHORE SYNCHRONIZATION AND THREAD MANAGEMENT: \n");
 
 InitSharedVars();
 SetTime();
@@ -229,10 +539,10 @@ sem_init(&mutex, 0, 1);
 int active_threads = 0;
 for (int i = 0; i < gThreadCount; i++) {																							// Loop over the number of configured threads to be started
     if (pthread_create(&tid[i], NULL, ThFindProdWithSemaphore, &params[i]) == 0) {													// Attempt to create each thread; pass it the function and parameters it should use
-        printf("Thread %d started with start: %d and end: %d\n", i, params[i][1], params[i][2]);									// On successful thread start, log and increment the count of actively started threads
+        Report("Thread %d started with start: %d and end: %d\n", i, params[i][1], params[i][2]);									// On successful thread start, log and increment the count of actively started threads
         active_threads++;
     } else {
-        printf("Failed to start thread %d\n", i);																					// If thread creation fails, log the failure
+        Report("Failed to start thread %d\n", i);																					// If thread creation fails, log the failure
     }
 }
 
@@ -245,16 +555,16 @@ while (completed_threads < active_threads && !zero_found) {																			//
 
     																																// Check the products calculated by each thread
     for (int i = 0; i < gThreadCount; i++) {
-        if (gThreadProd[i] == 0) {       																							// If a thread reports a zero product
+        if (atomic_load(&gThreadResult[i].product) == 0) {																						// If a thread reports a zero product
             zero_found = true;           																							// Set the flag to indicate a zero product was found
-            // FOR DEBUGGING printf("Zero product detected by thread %d.\n", i); 													// Log which thread found the zero
+            // FOR DEBUGGING Report("Zero product detected by thread %d.\n", i); 													// Log which thread found the zero
             break;                       																							// Exit the loop since we no longer need to check further
         }
     }
 
 
     if (zero_found) {																												// If a zero product was detected during the checks
-        // FOR DEBUGGING printf("Cancelling all threads due to zero detection.\n"); 												// Log that all threads will be cancelled	
+        // FOR DEBUGGING Report("Cancelling all threads due to zero detection.\n"); 												// Log that all threads will be cancelled	
         for (int i = 0; i < gThreadCount; i++) {																					// Cancel all threads to stop any further computation
             pthread_cancel(tid[i]);      																							// Send cancellation request to each thread
         }
@@ -264,7 +574,7 @@ while (completed_threads < active_threads && !zero_found) {																			//
 for (int i = 0; i < gThreadCount; i++) {																							// Ensure all threads are properly joined back to the main process
     pthread_join(tid[i], NULL);          																							// Wait for each thread to finish cleanup
     // Debugging print to confirm each thread has been joined
-    // printf("Thread %d has been joined.\n", i);
+    // Report("Thread %d has been joined.\n", i);
 }
 
 
@@ -272,19 +582,59 @@ sem_destroy(&completed);
 sem_destroy(&mutex);
 
 prod = ComputeTotalProduct();
-printf("Multi-threaded multiplication with semaphores completed in %ld ms. Product: %d\n", GetTime(), prod);
+ms = GetTime();
+Report("Multi-threaded multiplication with semaphores completed in %.3f ms. Product: %d\n", ms, prod);
+ReportThreads();
+RecordRun(VARIANT_SEMAPHORE, run, ms, prod);
 
 
 /*************** END OF SEMAPHORE SYNCHRONIZATION AND THREAD MANAGEMENT ***************/
 
 
 
-	// Exit the program
-    exit(0);
-}
+	/*************** START OF COOPERATIVE EARLY EXIT ***************/
+	/*
+		Cooperative Early Exit:
+			* No thread is cancelled: a worker that multiplies in a zero sets gZeroFound, and every other worker sees it at its next block and returns
+			* The parent sleeps on gDoneCond until all workers are done or one reports a zero, instead of spinning on the done flags
+			* When there is a zero, the report adds how long after it was found the parent woke and the last worker had stopped
+	*/
+	Report("\nSTART OF COOPERATIVE EARLY EXIT: \n");
+
+	InitSharedVars();
+	SetTime();
+	for (i = 0; i < gThreadCount; i++) {
+		if (pthread_create(&tid[i], NULL, ThFindProdCooperative, &params[i])) {
+			fprintf(stderr, "Error creating thread %d\n", i);
+			exit(1);
+		}
+	}
 
+	pthread_mutex_lock(&gDoneLock);
+	while (gWorkersDone < gThreadCount && !atomic_load(&gZeroFound)) {
+		pthread_cond_wait(&gDoneCond, &gDoneLock);							// Sleep until a worker has something to report
+	}
+	pthread_mutex_unlock(&gDoneLock);
+	long long wokeNs = GetNanoTime();
+	for (i = 0; i < gThreadCount; i++) {
+		pthread_join(tid[i], NULL);
+	}
+	long long stoppedNs = GetNanoTime();
+
+	prod = ComputeTotalProduct();
+	ms = GetTime();
+	Report("Threaded multiplication with cooperative early exit completed in %.3f ms. Product = %d\n", ms, prod);
+	ReportThreads();
+	RecordRun(VARIANT_COOPERATIVE, run, ms, prod);
+	if (atomic_load(&gZeroFound)) {
+		long long zeroNs = atomic_load(&gZeroFoundNs);
+		Report("Zero found: parent woke %.1f us later, all threads stopped %.1f us later\n",
+		       (wokeNs - zeroNs) / 1000.0, (stoppedNs - zeroNs) / 1000.0);
+	}
 
+	/*************** END OF COOPERATIVE EARLY EXIT ***************/
 
+}
 
 
 /*************** START OF SEQUENTIAL FIND PRODUCT ***************/
@@ -293,20 +643,11 @@ printf("Multi-threaded multiplication with semaphores completed in %ld ms. Produ
 		* Computes the product of all elements in the global array gData, modulo NUM_LIMIT to prevent overflow
 		* Early termination occurs if any element in the array is zero, returning zero immediately
 		* This method ensures efficient handling of cases where the product is inherently zero due to the presence of any zero in the array
-		* Utilizes a simple, linear iteration over the array to multiply elements, making it a straightforward, sequential approach
+		* Runs the selected product kernel (prod_kernels.h) over the array one block at a time, stopping at the first block whose product is zero
 		* Acts as a baseline for performance comparison against threaded implementations, or used when threading is inapplicable
 */
 int SqFindProd(int size) {
-    int product = 1;  
-
-    for (int i = 0; i < size; i++) {
-        if (gData[i] == 0) {
-            return 0;  									// If the element is zero, return 0 immediately
-        }
-        product = (product * gData[i]) % NUM_LIMIT;  	// Update the product with the next element modulo NUM_LIMIT
-    }
-
-    return product;  									// Return the final product
+    return ProdRange(gData, 0, size - 1);
 }
 
 
@@ -317,9 +658,10 @@ int SqFindProd(int size) {
 	Thread Product Computation:
 		* This function is executed by each thread to compute the product of all elements in one division of the gData array, using modulo NUM_LIMIT to manage overflow
 		* It operates on a slice of the array determined by start and end indices, calculating the product in such a way that numerical limits are not exceeded
-		* The product result is stored in the gThreadProd array at the index corresponding to the thread's number
-		* Upon completion, the thread updates the gThreadDone status to true, signaling that it has finished processing its segment of the array
-		* For visibility of thread activity, the function logs its operation commencement, aiding in debugging and monitoring of thread execution
+		* The product result is stored in the thread's gThreadResult slot
+		* Upon completion, the thread then sets the slot's done flag (release order, so a parent that sees it also sees the product), signaling that it has finished processing its segment of the array
+		* The thread records when it started and finished and how many elements it multiplied in its slot (ThreadBegin/ThreadEnd) instead of printing
+		  from inside the timed region; the parent reports them after the join
 */
 void *ThFindProd(void *param) {
     int *indices = (int*) param;
@@ -327,14 +669,13 @@ void *ThFindProd(void *param) {
     int start = indices[1];
     int end = indices[2];
 
-    printf("Thread %d started with start: %d and end: %d\n", threadNum, start, end);
+    long long elements = 0;
 
-    int localProd = 1;  																			// Assuming computation here
-    for (int i = start; i <= end; i++) {
-        localProd = (localProd * gData[i]) % NUM_LIMIT;
-    }
-    gThreadProd[threadNum] = localProd;
-    gThreadDone[threadNum] = true;  																// Set this thread as done
+    ThreadBegin(threadNum);
+    int localProd = ThreadProd(start, end, &elements);  											// Selected kernel over this division, or over chunks
+    ThreadEnd(threadNum, elements);
+    atomic_store_explicit(&gThreadResult[threadNum].product, localProd, memory_order_relaxed);
+    atomic_store_explicit(&gThreadResult[threadNum].done, true, memory_order_release);  			// Set this thread as done
     // FOR DEBUGGING printf("Thread %d finished with product %d\n", threadNum, localProd);
 
     return NULL;
@@ -345,7 +686,7 @@ void *ThFindProd(void *param) {
 /*
     Semaphore-Based Thread Product Computation:
 		* Each thread is tasked with computing the product of a specific segment of the gData array, modulo NUM_LIMIT to manage overflow
-		* The computed product is stored in the gThreadProd array at an index corresponding to the thread's assigned number
+		* The computed product is stored in the gThreadResult slot corresponding to the thread's assigned number
 		* If a zero is encountered during computation, the thread stores '0' as the product and ceases further multiplication
 		* Upon completing its computation task, regardless of the result (zero or non-zero), the thread increments the shared gDoneThreadCount variable
 		This increment operation is protected by a 'mutex' semaphore to ensure thread-safe modifications
@@ -359,19 +700,16 @@ void* ThFindProdWithSemaphore(void *param) {
     int threadNum = parameters[0];
     int start = parameters[1];
     int end = parameters[2];
-    int localProd = 1;
 
  																					//FOR DEBUGGING printf("Thread %d started computation with start: %d and end: %d\n", threadNum, start, end);
 
-    for (int i = start; i <= end; i++) { 											// Loop through the assigned segment
-        if (gData[i] == 0) {
-            localProd = 0;
-            break; 																	// Stop computation if zero is found
-        }
-        localProd = (localProd * gData[i]) % NUM_LIMIT;
-    }
+    long long elements = 0;
 
-    gThreadProd[threadNum] = localProd; 											// Store result in global array
+    ThreadBegin(threadNum);
+    int localProd = ThreadProd(start, end, &elements); 							// Stops at the first block whose product is zero
+    ThreadEnd(threadNum, elements);
+
+    atomic_store(&gThreadResult[threadNum].product, localProd); 					// Store result in the thread's slot
     																				// FOR DEBUGGING printf("Thread %d completed with product: %d\n", threadNum, localProd);
 	/* FOR DEBUGGING 
     if (localProd == 0) {
@@ -395,7 +733,7 @@ int ComputeTotalProduct() {
 
 	for(i=0; i<gThreadCount; i++)
 	{
-		prod *= gThreadProd[i];
+		prod *= atomic_load(&gThreadResult[i].product);
 		prod %= NUM_LIMIT;
 	}
 
@@ -406,10 +744,475 @@ void InitSharedVars() {
 	int i;
 
 	for(i=0; i<gThreadCount; i++){
-		gThreadDone[i] = false;
-		gThreadProd[i] = 1;
+		atomic_store(&gThreadResult[i].done, false);
+		atomic_store(&gThreadResult[i].product, 1);
+		gThreadResult[i].startNs = gThreadResult[i].finishNs = 0;
+		gThreadResult[i].elements = 0;
+		for (int c = 0; c < PERF_COUNTERS; c++) {
+			gThreadResult[i].perfFd[c] = -1;
+			gThreadResult[i].counters[c] = -1;
+		}
 	}
 	gDoneThreadCount = 0;
+	atomic_store(&gNextChunk, 0);
+	atomic_store(&gZeroFound, false);
+	atomic_store(&gZeroFoundNs, 0);
+	gWorkersDone = 0;
+}
+
+/*************** START OF INSTRUMENTATION ***************/
+/*
+	Per-Thread Instrumentation:
+		* Every threaded worker calls ThreadBegin before its share and ThreadEnd after it, which fill its gThreadResult slot
+		  with the CLOCK_MONOTONIC start and finish and the elements it multiplied; nothing is printed from inside a worker
+		* With --perf, ThreadBegin also opens cycle, instruction and cache miss counters for the calling thread, user space only
+		  so the default perf_event_paranoid setting allows it; ThreadEnd reads and closes them
+		     -Cancellation is held off while the counters are read, a cancelled worker would otherwise leak the descriptors
+		* The imbalance of a run is the slowest thread's busy time over the mean busy time, 1.0 when the split is perfect
+*/
+static const struct { uint32_t type; uint64_t config; const char *name; } gPerfEvents[PERF_COUNTERS] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "cache_misses" }
+};
+
+// Counter c for the calling thread on whatever CPU it runs, counting from now; -1 if perf_event_open refuses
+int PerfOpen(int c) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = gPerfEvents[c].type;
+    attr.config = gPerfEvents[c].config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+void ThreadBegin(int threadNum) {
+    ThreadResult *slot = &gThreadResult[threadNum];
+
+    for (int c = 0; gPerf && c < PERF_COUNTERS; c++) {
+        slot->perfFd[c] = PerfOpen(c);
+    }
+    slot->startNs = GetNanoTime();
+}
+
+void ThreadEnd(int threadNum, long long elements) {
+    ThreadResult *slot = &gThreadResult[threadNum];
+    int oldState;
+
+    slot->finishNs = GetNanoTime();
+    slot->elements = elements;
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldState);
+    for (int c = 0; c < PERF_COUNTERS; c++) {
+        if (slot->perfFd[c] >= 0) {
+            long long value;
+            slot->counters[c] = read(slot->perfFd[c], &value, sizeof(value)) == sizeof(value) ? value : -1;
+            close(slot->perfFd[c]);
+            slot->perfFd[c] = -1;
+        }
+    }
+    pthread_setcancelstate(oldState, NULL);
+}
+
+void Report(const char *format, ...) {
+    va_list args;
+
+    if (gRepeat > 0) {
+        return;
+    }
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void RecordRun(int variant, int run, double ms, int prod) {
+    if (gRepeat == 0) {
+        return;
+    }
+    if (gRuns == NULL && (gRuns = calloc((size_t) gRepeat * VARIANT_COUNT, sizeof(RunRecord))) == NULL) {
+        fprintf(stderr, "Unable to allocate the run records\n");
+        exit(1);
+    }
+    RunRecord *rec = &gRuns[run * VARIANT_COUNT + variant];
+    rec->ms = ms;
+    rec->product = prod;
+    for (int i = 0; variant != VARIANT_SEQUENTIAL && i < gThreadCount; i++) {
+        ThreadResult *slot = &gThreadResult[i];
+        rec->startMs[i] = (slot->startNs - gRefTime) / 1e6;
+        rec->busyMs[i] = (slot->finishNs - slot->startNs) / 1e6;
+        rec->elements[i] = slot->elements;
+        memcpy(rec->counters[i], slot->counters, sizeof(slot->counters));
+    }
+}
+
+static double Imbalance(const double busyMs[MAX_THREADS]) {
+    double sum = 0.0, max = 0.0;
+
+    for (int i = 0; i < gThreadCount; i++) {
+        sum += busyMs[i];
+        max = busyMs[i] > max ? busyMs[i] : max;
+    }
+    return sum > 0.0 ? max / (sum / gThreadCount) : 1.0;
+}
+
+void ReportThreads(void) {
+    double busyMs[MAX_THREADS], minBusy = 0.0, maxBusy = 0.0, lastStart = 0.0;
+    long long minElems = 0, maxElems = 0, totals[PERF_COUNTERS] = { 0 };
+    bool counted = gPerf;
+
+    for (int i = 0; i < gThreadCount; i++) {
+        ThreadResult *slot = &gThreadResult[i];
+        double start = (slot->startNs - gRefTime) / 1e6;
+        busyMs[i] = (slot->finishNs - slot->startNs) / 1e6;
+        minBusy = i == 0 || busyMs[i] < minBusy ? busyMs[i] : minBusy;
+        maxBusy = i == 0 || busyMs[i] > maxBusy ? busyMs[i] : maxBusy;
+        minElems = i == 0 || slot->elements < minElems ? slot->elements : minElems;
+        maxElems = i == 0 || slot->elements > maxElems ? slot->elements : maxElems;
+        lastStart = start > lastStart ? start : lastStart;
+        for (int c = 0; c < PERF_COUNTERS; c++) {
+            counted = counted && slot->counters[c] >= 0;
+            totals[c] += slot->counters[c];
+        }
+    }
+    Report("  threads busy %.3f to %.3f ms (imbalance %.2f), last one started at %.3f ms, %lld to %lld elements each\n",
+           minBusy, maxBusy, Imbalance(busyMs), lastStart, minElems, maxElems);
+    if (counted) {
+        Report("  %lld cycles, %lld instructions (IPC %.2f), %lld cache misses over all threads\n", totals[0], totals[1],
+               totals[0] > 0 ? (double) totals[1] / totals[0] : 0.0, totals[2]);
+    }
+}
+
+static int CompareDouble(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+// Prints {"min": .., "median": .., "max": ..} of values[0..n-1] (reordered)
+static void PrintStats(double *values, int n) {
+    qsort(values, n, sizeof(double), CompareDouble);
+    double median = n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2.0;
+    printf("{\"min\": %.6f, \"median\": %.6f, \"max\": %.6f}", values[0], median, values[n - 1]);
+}
+
+void PrintRepeatJson(int arraySize) {
+    double *values = malloc((size_t) gRepeat * sizeof(double));
+    if (values == NULL) {
+        fprintf(stderr, "Unable to allocate the summary\n");
+        exit(1);
+    }
+
+    printf("{\n  \"array_size\": %d, \"threads\": %d, \"runs\": %d, \"kernel\": \"%s\", \"schedule\": \"%s\", \"storage\": \"%s\",\n",
+           arraySize, gThreadCount, gRepeat, gProdKernelName, gSchedule == SCHEDULE_CHUNKED ? "chunked" : "static",
+           gStorage == STORAGE_UINT16 ? "uint16" : "int");
+    printf("  \"variants\": [\n");
+    for (int v = 0; v < VARIANT_COUNT; v++) {
+        RunRecord *last = &gRuns[(gRepeat - 1) * VARIANT_COUNT + v];
+
+        printf("    {\"name\": \"%s\", \"product\": %d, \"ms\": ", gVariantNames[v], last->product);
+        for (int r = 0; r < gRepeat; r++) {
+            values[r] = gRuns[r * VARIANT_COUNT + v].ms;
+        }
+        PrintStats(values, gRepeat);
+        if (v == VARIANT_SEQUENTIAL) {
+            printf("}%s\n", v + 1 < VARIANT_COUNT ? "," : "");
+            continue;
+        }
+
+        printf(",\n     \"imbalance\": ");
+        for (int r = 0; r < gRepeat; r++) {
+            values[r] = Imbalance(gRuns[r * VARIANT_COUNT + v].busyMs);
+        }
+        PrintStats(values, gRepeat);
+        printf(",\n     \"per_thread\": [\n");
+        for (int i = 0; i < gThreadCount; i++) {
+            printf("       {\"thread\": %d, \"elements\": %lld, \"start_ms\": ", i, last->elements[i]);
+            for (int r = 0; r < gRepeat; r++) {
+                values[r] = gRuns[r * VARIANT_COUNT + v].startMs[i];
+            }
+            PrintStats(values, gRepeat);
+            printf(", \"busy_ms\": ");
+            for (int r = 0; r < gRepeat; r++) {
+                values[r] = gRuns[r * VARIANT_COUNT + v].busyMs[i];
+            }
+            PrintStats(values, gRepeat);
+            for (int c = 0; c < PERF_COUNTERS; c++) {                   // Medians, only when every run measured the counter
+                bool counted = gPerf;
+                for (int r = 0; r < gRepeat; r++) {
+                    values[r] = (double) gRuns[r * VARIANT_COUNT + v].counters[i][c];
+                    counted = counted && values[r] >= 0.0;
+                }
+                if (counted) {
+                    qsort(values, gRepeat, sizeof(double), CompareDouble);
+                    printf(", \"%s\": %.0f", gPerfEvents[c].name, values[gRepeat / 2]);
+                }
+            }
+            printf("}%s\n", i + 1 < gThreadCount ? "," : "");
+        }
+        printf("     ]}%s\n", v + 1 < VARIANT_COUNT ? "," : "");
+    }
+    printf("  ]\n}\n");
+    free(values);
+    free(gRuns);
+    gRuns = NULL;
+}
+
+/*************** START OF CHUNKED SCHEDULING ***************/
+/*
+	Thread Share of the Product:
+		* With the static schedule a thread multiplies exactly its CalculateIndices division
+		* With the chunked schedule the division is ignored: the thread keeps taking the next chunk from gNextChunk until the array is used up
+		     -A thread on a slow core or one that gets preempted simply takes fewer chunks, so nobody waits for it at the end
+		     -The chunks a thread took are multiplied into its one gThreadResult slot; the product is commutative, so ComputeTotalProduct is unchanged
+		* Either way the thread stops as soon as its own product is zero or gZeroFound says another thread's is,
+		  checking once per PROD_BLOCK elements, a few microseconds of work
+		     -A thread stopped by the flag returns a partial product, which is fine: the total is zero anyway
+*/
+static int ThreadRangeProd(long start, long end, long long *elements) {
+    uint32_t product = 1;
+
+    for (long i = start; i <= end && product != 0; i += PROD_BLOCK) {
+        if (atomic_load_explicit(&gZeroFound, memory_order_relaxed)) {
+            break;
+        }
+        long n = end - i + 1 < PROD_BLOCK ? end - i + 1 : PROD_BLOCK;
+        product = ProdReduce(product * (uint32_t) ProdKernelAt(gData, i, n));
+        *elements += n;
+    }
+    if (product == 0) {
+        long long expected = 0;
+        atomic_compare_exchange_strong(&gZeroFoundNs, &expected, GetNanoTime());   // Only the first finder's time counts
+        atomic_store(&gZeroFound, true);
+    }
+    return (int) product;
+}
+
+int ThreadProd(int start, int end, long long *elements) {
+    if (gSchedule == SCHEDULE_STATIC) {
+        return ThreadRangeProd(start, end, elements);
+    }
+
+    long chunkCount = ((long) gArraySize + gChunkSize - 1) / gChunkSize;      // In long, gChunkSize may be up to INT_MAX
+    uint32_t product = 1;
+    int chunk;
+    while (product != 0 && !atomic_load_explicit(&gZeroFound, memory_order_relaxed) &&
+           (chunk = atomic_fetch_add_explicit(&gNextChunk, 1, memory_order_relaxed)) < chunkCount) {
+        long first = (long) chunk * gChunkSize;
+        long last = first + gChunkSize - 1 < gArraySize - 1 ? first + gChunkSize - 1 : gArraySize - 1;
+        product = ProdReduce(product * (uint32_t) ThreadRangeProd(first, last, elements));
+    }
+    return (int) product;
+}
+
+void *ThFindProdCooperative(void *param) {
+    int *parameters = (int*)param;
+    int threadNum = parameters[0];
+    long long elements = 0;
+
+    ThreadBegin(threadNum);
+    int localProd = ThreadProd(parameters[1], parameters[2], &elements);
+    ThreadEnd(threadNum, elements);
+
+    atomic_store(&gThreadResult[threadNum].product, localProd);
+    pthread_mutex_lock(&gDoneLock);
+    gWorkersDone++;
+    if (gWorkersDone == gThreadCount || localProd == 0) {
+        pthread_cond_signal(&gDoneCond);                            // Only the parent waits on it
+    }
+    pthread_mutex_unlock(&gDoneLock);
+    return NULL;
+}
+
+/*************** START OF SHARING BENCHMARK ***************/
+/*
+	Result Layout Benchmark:
+		* Compares the old layout, one int array for the products and one bool array for the done flags, with gThreadResult
+		     -Packed, the 16 products share a single 64-byte line, so every store by one thread invalidates that line in every other core
+		     -Padded, each thread's product and flag sit on a line nobody else writes
+		* To make the stores frequent enough to measure, the workers publish their running product after every SHARING_BENCH_BLOCK
+		  elements, while the parent busy-polls the done flags the way the first threaded variant does
+		* Each layout runs SHARING_BENCH_RUNS times and the fastest run is reported; the products must agree
+		* With fewer cores than threads the workers rarely run at the same time and the two layouts time about the same
+*/
+typedef struct {
+    int start;
+    int end;
+    atomic_int *product;
+    atomic_bool *done;
+} SharingBenchSlot;
+
+void *ThSharingBench(void *param) {
+    SharingBenchSlot *slot = param;
+    uint32_t product = 1;
+
+    for (long i = slot->start; i <= slot->end; i += SHARING_BENCH_BLOCK) {
+        long n = slot->end - i + 1 < SHARING_BENCH_BLOCK ? slot->end - i + 1 : SHARING_BENCH_BLOCK;
+        product = ProdReduce(product * (uint32_t) ProdKernelAt(gData, i, n));
+        atomic_store_explicit(slot->product, (int) product, memory_order_relaxed);   // Progress report, the hot store
+    }
+    atomic_store_explicit(slot->done, true, memory_order_release);
+    return NULL;
+}
+
+// Run the workers once on the given slots and return the elapsed nanoseconds, *prod receives the total product
+static long long SharingBenchRun(SharingBenchSlot slots[MAX_THREADS], int *prod) {
+    pthread_t tid[MAX_THREADS];
+    long long start = GetNanoTime();
+
+    for (int i = 0; i < gThreadCount; i++) {
+        atomic_store(slots[i].product, 1);
+        atomic_store(slots[i].done, false);
+        if (pthread_create(&tid[i], NULL, ThSharingBench, &slots[i])) {
+            fprintf(stderr, "Error creating benchmark thread %d\n", i);
+            exit(1);
+        }
+    }
+    for (int i = 0; i < gThreadCount; i++) {
+        while (!atomic_load_explicit(slots[i].done, memory_order_acquire)) {
+            ; 															// Busy-wait, reading the same lines the workers write
+        }
+    }
+    long long elapsed = GetNanoTime() - start;
+
+    uint32_t product = 1;
+    for (int i = 0; i < gThreadCount; i++) {
+        pthread_join(tid[i], NULL);
+        product = ProdReduce(product * (uint32_t) atomic_load(slots[i].product));
+    }
+    *prod = (int) product;
+    return elapsed;
+}
+
+void SharingBench(int indices[MAX_THREADS][3]) {
+    static atomic_int packedProd[MAX_THREADS];
+    static atomic_bool packedDone[MAX_THREADS];
+    SharingBenchSlot packed[MAX_THREADS], padded[MAX_THREADS];
+    long long best[2] = { 0, 0 };
+    int prod[2] = { 0, 0 };
+
+    for (int i = 0; i < gThreadCount; i++) {
+        packed[i] = (SharingBenchSlot) { indices[i][1], indices[i][2], &packedProd[i], &packedDone[i] };
+        padded[i] = (SharingBenchSlot) { indices[i][1], indices[i][2], &gThreadResult[i].product, &gThreadResult[i].done };
+    }
+    for (int run = 0; run < SHARING_BENCH_RUNS; run++) {
+        for (int layout = 0; layout < 2; layout++) {                  // Alternate so drift affects both layouts alike
+            long long ns = SharingBenchRun(layout == 0 ? packed : padded, &prod[layout]);
+            if (run == 0 || ns < best[layout]) {
+                best[layout] = ns;
+            }
+        }
+    }
+
+    printf("Result layouts, %d threads, product stored every %d elements, best of %d runs:\n",
+           gThreadCount, SHARING_BENCH_BLOCK, SHARING_BENCH_RUNS);
+    printf("  packed (%zu bytes per slot): %8.3f ms. Product = %d\n", sizeof(int), best[0] / 1e6, prod[0]);
+    printf("  padded (%zu bytes per slot): %8.3f ms. Product = %d\n", sizeof(ThreadResult), best[1] / 1e6, prod[1]);
+    if (prod[0] != prod[1]) {
+        fprintf(stderr, "The two layouts disagree on the product\n");
+        exit(1);
+    }
+}
+
+/*************** START OF DATA ALLOCATION ***************/
+/*
+	Data Array Allocation:
+		* gData is an anonymous mapping of exactly arraySize elements (rounded up to a page) instead of a MAX_SIZE static array
+		* Nothing is written here: the kernel only places a page when it is first touched, which GenerateInput does per division
+		* --huge-pages asks for explicit 2 MB pages (MAP_HUGETLB), which need pages reserved in /proc/sys/vm/nr_hugepages
+		     -Without a reservation it falls back to normal pages with a transparent huge page hint (MADV_HUGEPAGE)
+		* --interleave sets an interleave policy on the mapping with mbind, so pages go round-robin over the allowed nodes
+		  whichever thread touches them; called through syscall() so libnuma is not needed
+*/
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3 // From linux/mempolicy.h
+#endif
+#define HUGE_PAGE_SIZE (2UL << 20)
+
+void AllocateData(int size) {
+    size_t bytes = (size_t) size * (gStorage == STORAGE_UINT16 ? sizeof(uint16_t) : sizeof(int));
+    const char *pages = "normal";
+    void *map = MAP_FAILED;
+
+    if (gHugePages) {
+        gDataBytes = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        map = mmap(NULL, gDataBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        pages = "explicit 2 MB";
+    }
+    if (map == MAP_FAILED) {
+        long pageSize = sysconf(_SC_PAGESIZE);
+        gDataBytes = (bytes + pageSize - 1) & ~((size_t) pageSize - 1);
+        map = mmap(NULL, gDataBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED) {
+            perror("Unable to map the data array");
+            exit(1);
+        }
+        if (gHugePages) {
+            pages = madvise(map, gDataBytes, MADV_HUGEPAGE) == 0 ? "transparent huge" : "normal";
+        }
+    }
+
+    if (gInterleave) {
+        unsigned long nodes = ~0UL;   								// Every node; the kernel keeps only those the process may use
+        if (syscall(SYS_mbind, map, gDataBytes, MPOL_INTERLEAVE, &nodes, sizeof(nodes) * 8, 0) != 0) {
+            perror("Unable to interleave the data array, keeping first-touch placement");
+            gInterleave = false;
+        }
+    }
+    gData = gStorage == STORAGE_UINT16 ? (ProdArray) { NULL, map } : (ProdArray) { map, NULL };
+    Report("Data array: %.1f MB of %s elements on %s pages, %s\n", gDataBytes / 1048576.0,
+           gStorage == STORAGE_UINT16 ? "16-bit" : "32-bit", pages,
+           gInterleave ? "interleaved across NUMA nodes" : "placed by the thread that first touches it");
+}
+
+void FreeData(void) {
+    munmap(gData.u16 != NULL ? (void *) gData.u16 : (void *) gData.i32, gDataBytes);
+    gData = (ProdArray) { NULL, NULL };
+}
+
+/*************** START OF FILE INPUT ***************/
+/*
+	File Input:
+		* With --input the array size and index for zero are ignored: the file decides both, and nothing is generated
+		* The elements are 32-bit ints, or 16-bit with --storage=uint16, and go through the pool windows of prod_file.h
+		* The rate is the file bytes multiplied over the wall time. For pread the report also splits where the parent waited:
+		     -mostly on reads means the disk is the limit, mostly on the workers means the CPU is; both small means they overlap well
+		* --save-input writes a generated array in the same format, so the two paths can be checked against each other
+*/
+void FileProd(void) {
+    int width = gStorage == STORAGE_UINT16 ? sizeof(uint16_t) : sizeof(int);
+    ProdFileStats stats;
+    ProdPool pool;
+
+    if (ProdPoolInit(&pool, (ProdArray) { NULL, NULL }, gThreadCount) != 0) {
+        exit(1);
+    }
+    int prod = gInputMmap ? ProdFileMmap(&pool, gInputPath, width, &stats) : ProdFilePread(&pool, gInputPath, width, &stats);
+    ProdPoolDestroy(&pool);
+    if (prod < 0) {
+        exit(1);
+    }
+
+    double gb = stats.elements * (double) width / 1e9;
+    printf("File multiplication (%s, %d threads) of %lld elements completed in %.3f ms. Product = %d\n",
+           gInputMmap ? "mmap" : "pread", gThreadCount, stats.elements, stats.seconds * 1e3, prod);
+    printf("Read %.3f GB at %.2f GB/s\n", gb, stats.seconds > 0.0 ? gb / stats.seconds : 0.0);
+    if (!gInputMmap) {
+        printf("Parent waited %.3f ms on reads and %.3f ms on the workers: %s-bound\n", stats.readWait * 1e3,
+               stats.computeWait * 1e3, stats.readWait >= stats.computeWait ? "disk" : "CPU");
+    }
+}
+
+void SaveInput(int size) {
+    size_t bytes = (size_t) size * (gData.u16 != NULL ? sizeof(uint16_t) : sizeof(int));
+    const char *base = gData.u16 != NULL ? (const char *) gData.u16 : (const char *) gData.i32;
+    FILE *out = fopen(gSavePath, "wb");
+
+    if (out == NULL || fwrite(base, 1, bytes, out) != bytes || fclose(out) != 0) {
+        perror(gSavePath);
+        exit(1);
+    }
+    printf("Saved %d elements to %s\n", size, gSavePath);
 }
 
 /*************** START OF GENERATE INPUT ***************/
@@ -417,18 +1220,67 @@ void InitSharedVars() {
 	Input Array Initialization:
 		* Populates the global array 'gData' with random numbers ranging from 1 to MAX_RANDOM_NUMBER
 		     -This ensures variability in the data set used for multiplication
-		* Initializes the random number generator with the RANDOM_SEED for reproducible results across different runs
+		* Uses the same divisions as the product threads, one generating thread per division
+		     -gData is untouched until here, so each page is placed on the NUMA node of the thread that fills it
+		     -Generating thread i is pinned to the same CPU as pool worker i, whose share of a whole-array query is exactly division i
+		     -Division i draws from the xoshiro256** stream seeded with RANDOM_SEED and jumped i times, so the streams never overlap
+		     -The array is the same on every run for a given RANDOM_SEED and thread count
+		* libc rand() is not used here: it serializes on an internal lock and its modulo dominated the run time for 100M elements
 		* If 'indexForZero' is a valid non-negative index within the array bounds, sets that position in the array to zero
 		     -This allows testing scenarios where the product of the array elements should logically result in zero
 */
 void GenerateInput(int size, int indexForZero) {
-    srand(RANDOM_SEED);  
-    for (int i = 0; i < size; i++) {
-        gData[i] = GetRand(1, MAX_RANDOM_NUMBER);  
+    pthread_t tid[MAX_THREADS];
+    int indices[MAX_THREADS][3];
+    RandState streams[MAX_THREADS];
+    struct { int start; int end; RandState *rng; } params[MAX_THREADS];
+
+    CalculateIndices(size, gThreadCount, indices);
+    RandSeed(&streams[0], RANDOM_SEED);
+    for (int i = 0; i < gThreadCount; i++) {
+        if (i > 0) {
+            streams[i] = streams[i - 1];
+            RandJump(&streams[i]);  								// Stream i starts 2^128 values after stream i-1
+        }
+        params[i].start = indices[i][1];
+        params[i].end = indices[i][2];
+        params[i].rng = &streams[i];
+        pthread_attr_t attr;
+        cpu_set_t cpu;
+        pthread_attr_init(&attr);
+        if (ProdPoolCpu(i, &cpu)) {
+            pthread_attr_setaffinity_np(&attr, sizeof(cpu), &cpu);	// Pinned before it starts, so no page is touched from the wrong CPU
+        }
+        int rc = pthread_create(&tid[i], &attr, ThGenerateInput, &params[i]);
+        pthread_attr_destroy(&attr);
+        if (rc) {
+            fprintf(stderr, "Error creating input thread %d\n", i);
+            exit(1);
+        }
     }
+    for (int i = 0; i < gThreadCount; i++) {
+        pthread_join(tid[i], NULL);
+    }
+
     if (indexForZero >= 0 && indexForZero < size) {
-        gData[indexForZero] = 0;  
+        ProdSetElem(gData, indexForZero, 0);
+    }
+}
+
+void *ThGenerateInput(void *param) {
+    struct { int start; int end; RandState *rng; } *division = param;
+    RandState rng = *division->rng;  								// Local copy keeps the state in registers
+
+    if (gData.u16 != NULL) {
+        for (int i = division->start; i <= division->end; i++) {
+            gData.u16[i] = (uint16_t) RandRange(&rng, 1, MAX_RANDOM_NUMBER);   	// Same stream, same values in either width
+        }
+    } else {
+        for (int i = division->start; i <= division->end; i++) {
+            gData.i32[i] = RandRange(&rng, 1, MAX_RANDOM_NUMBER);
+        }
     }
+    return NULL;
 }
 
 
@@ -457,35 +1309,108 @@ void CalculateIndices(int arraySize, int thrdCnt, int indices[MAX_THREADS][3]) {
     }
 }
 
-// Get a random number in the range [x, y]
-int GetRand(int x, int y) {
-    int r = rand();
-    r = x + r % (y-x+1);
-    return r;
-}
-
-long GetMilliSecondTime(struct timeb timeBuf){
-	long mliScndTime;
-	mliScndTime = timeBuf.time;
-	mliScndTime *= 1000;
-	mliScndTime += timeBuf.millitm;
-	return mliScndTime;
+/*************** START OF OPTIONS ***************/
+int ParseOption(const char *arg) {
+    if (strncmp(arg, "--kernel=", 9) == 0) {
+        return ProdSelectKernel(arg + 9);
+    }
+    if (strncmp(arg, "--schedule=", 11) == 0) {
+        if (strcmp(arg + 11, "static") == 0) {
+            gSchedule = SCHEDULE_STATIC;
+        } else if (strcmp(arg + 11, "chunked") == 0) {
+            gSchedule = SCHEDULE_CHUNKED;
+        } else {
+            fprintf(stderr, "Unknown schedule '%s' (expected static or chunked)\n", arg + 11);
+            return -1;
+        }
+        return 0;
+    }
+    if (strncmp(arg, "--chunk=", 8) == 0) {
+        gChunkSize = atoi(arg + 8);
+        if (gChunkSize <= 0) {
+            fprintf(stderr, "Chunk size must be a positive number of elements\n");
+            return -1;
+        }
+        gSchedule = SCHEDULE_CHUNKED;                               // A chunk size only means something with the chunked schedule
+        return 0;
+    }
+    if (strncmp(arg, "--queries=", 10) == 0) {
+        gPoolQueries = atoi(arg + 10);
+        if (gPoolQueries < 0) {
+            fprintf(stderr, "Query count cannot be negative\n");
+            return -1;
+        }
+        return 0;
+    }
+    if (strncmp(arg, "--storage=", 10) == 0) {
+        if (strcmp(arg + 10, "int") == 0) {
+            gStorage = STORAGE_INT;
+        } else if (strcmp(arg + 10, "uint16") == 0) {
+            gStorage = STORAGE_UINT16;
+        } else {
+            fprintf(stderr, "Unknown storage '%s' (expected int or uint16)\n", arg + 10);
+            return -1;
+        }
+        return 0;
+    }
+    if (strncmp(arg, "--input=", 8) == 0) {
+        gInputPath = arg + 8;
+        return 0;
+    }
+    if (strncmp(arg, "--io=", 5) == 0) {
+        if (strcmp(arg + 5, "pread") == 0) {
+            gInputMmap = false;
+        } else if (strcmp(arg + 5, "mmap") == 0) {
+            gInputMmap = true;
+        } else {
+            fprintf(stderr, "Unknown I/O method '%s' (expected pread or mmap)\n", arg + 5);
+            return -1;
+        }
+        return 0;
+    }
+    if (strncmp(arg, "--save-input=", 13) == 0) {
+        gSavePath = arg + 13;
+        return 0;
+    }
+    if (strcmp(arg, "--huge-pages") == 0) {
+        gHugePages = true;
+        return 0;
+    }
+    if (strcmp(arg, "--interleave") == 0) {
+        gInterleave = true;
+        return 0;
+    }
+    if (strncmp(arg, "--repeat=", 9) == 0) {
+        gRepeat = atoi(arg + 9);
+        if (gRepeat <= 0) {
+            fprintf(stderr, "Repeat count must be positive\n");
+            return -1;
+        }
+        return 0;
+    }
+    if (strcmp(arg, "--perf") == 0) {
+        gPerf = true;
+        return 0;
+    }
+    if (strcmp(arg, "--sharing-bench") == 0) {
+        gSharingBench = true;
+        return 0;
+    }
+    fprintf(stderr, "Unknown option '%s'\n", arg);
+    return -1;
 }
 
-long GetCurrentTime(void){
-	long crntTime=0;
-	struct timeb timeBuf;
-	ftime(&timeBuf);
-	crntTime = GetMilliSecondTime(timeBuf);
-	return crntTime;
+long long GetNanoTime(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
 }
 
 void SetTime(void){
-	gRefTime = GetCurrentTime();
+	gRefTime = GetNanoTime();
 }
 
-long GetTime(void){
-	long crntTime = GetCurrentTime();
-	return (crntTime - gRefTime);
+double GetTime(void){
+	return (GetNanoTime() - gRefTime) / 1e6;
 }
 
@@ -0,0 +1,211 @@
+#ifndef PROD_FILE_H
+#define PROD_FILE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "prod_kernels.h"
+#include "prod_pool.h"
+
+/*
+* Products over element files
+* The file is raw native-endian elements, 4 or 2 bytes each, with no header; a trailing partial element is ignored.
+* It is never loaded whole, so it can be larger than memory. Windows of PROD_FILE_WINDOW bytes go through the pool,
+* and while the pool multiplies one window the next is already being read:
+*     -pread: two buffers, the caller reads into one while the workers multiply the other
+*     -mmap: the file is mapped read-only, the next window gets MADV_WILLNEED so readahead runs during the current one,
+*      and finished windows are dropped from the mapping so resident memory stays at about two windows
+* A zero element ends the scan at the window it is found in.
+* The file is outside data, so 32-bit elements are checked against the kernels' bound before they reach a kernel: any
+* value below 0 or at or above PROD_FILE_ELEM_LIMIT is reduced into [0, NUM_LIMIT), which leaves the product unchanged.
+* 16-bit elements are always below the bound.
+*/
+
+#define PROD_FILE_WINDOW (16UL << 20)   // Bytes per window, a multiple of the page size and of both element widths
+#define PROD_FILE_ELEM_LIMIT (1 << 18)   // The kernels need 0 <= data[i] < 2^18, see prod_kernels.h
+
+typedef struct {
+    long long elements;         // Elements multiplied, fewer than in the file if a zero ended the scan early
+    double seconds;
+    double readWait;            // pread only: seconds the caller spent reading while the workers may have been idle
+    double computeWait;         // pread only: seconds the caller waited on the workers after its read was done
+} ProdFileStats;
+
+static double ProdFileSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// True if every element of data[0..n-1] can go straight to a kernel
+static bool ProdFileInRange(const int *data, long n) {
+    bool inRange = true;
+
+    for (long i = 0; i < n; i++) {
+        inRange &= (uint32_t) data[i] < PROD_FILE_ELEM_LIMIT;   // Negatives wrap to huge values; no branch, so it vectorizes
+    }
+    return inRange;
+}
+
+// dst[i] = src[i], reduced into [0, NUM_LIMIT) when the kernels could not take it; dst may be src
+static void ProdFileReduce(int *dst, const int *src, long n) {
+    for (long i = 0; i < n; i++) {
+        int v = src[i];
+        dst[i] = (uint32_t) v < PROD_FILE_ELEM_LIMIT ? v : ((v % NUM_LIMIT) + NUM_LIMIT) % NUM_LIMIT;
+    }
+}
+
+static ProdArray ProdFileArray(void *base, int width) {
+    return width == 2 ? (ProdArray) { NULL, base } : (ProdArray) { base, NULL };
+}
+
+// Fill buf from offset, retrying short reads; returns the bytes read, less than len only at end of file, or -1
+static ssize_t ProdFileRead(int fd, void *buf, size_t len, off_t offset) {
+    size_t done = 0;
+
+    while (done < len) {
+        ssize_t n = pread(fd, (char *) buf + done, len - done, offset + done);
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    return (ssize_t) done;
+}
+
+// Product mod NUM_LIMIT of the file's elements through the pool with double-buffered pread, -1 on an I/O error
+static int ProdFilePread(ProdPool *pool, const char *path, int width, ProdFileStats *stats) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    void *buffers[2] = { aligned_alloc(4096, PROD_FILE_WINDOW), aligned_alloc(4096, PROD_FILE_WINDOW) };
+    if (buffers[0] == NULL || buffers[1] == NULL) {
+        fprintf(stderr, "Unable to allocate the read buffers\n");
+        free(buffers[0]);
+        free(buffers[1]);
+        close(fd);
+        return -1;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    uint32_t product = 1;
+    off_t offset = 0;
+    int current = 0;
+    *stats = (ProdFileStats) { 0, 0.0, 0.0, 0.0 };
+    double start = ProdFileSeconds();
+    ssize_t filled = ProdFileRead(fd, buffers[0], PROD_FILE_WINDOW, 0);
+    if (filled > 0 && width == sizeof(int)) {
+        ProdFileReduce(buffers[0], buffers[0], filled / width);
+    }
+    stats->readWait = ProdFileSeconds() - start;                // Nothing to overlap the first window with, the workers are idle
+
+    while (filled >= width) {
+        long count = filled / width;
+        pool->data = ProdFileArray(buffers[current], width);      // Workers only look at it after the start barrier
+        ProdPoolSubmit(pool, 0, count - 1);
+        offset += filled;
+
+        double t = ProdFileSeconds();
+        ssize_t next = filled == (ssize_t) PROD_FILE_WINDOW ? ProdFileRead(fd, buffers[current ^ 1], PROD_FILE_WINDOW, offset) : 0;
+        if (next > 0 && width == sizeof(int)) {
+            ProdFileReduce(buffers[current ^ 1], buffers[current ^ 1], next / width);   // Still overlapped with the workers
+        }
+        double u = ProdFileSeconds();
+        product = ProdReduce(product * (uint32_t) ProdPoolWait(pool));
+        stats->readWait += u - t;
+        stats->computeWait += ProdFileSeconds() - u;
+        stats->elements += count;
+
+        if (next < 0) {
+            perror(path);
+            product = (uint32_t) -1;
+            break;
+        }
+        if (product == 0) {
+            break;
+        }
+        filled = next;
+        current ^= 1;
+    }
+    if (filled < 0) {
+        perror(path);
+        product = (uint32_t) -1;
+    }
+    stats->seconds = ProdFileSeconds() - start;
+
+    free(buffers[0]);
+    free(buffers[1]);
+    close(fd);
+    return (int) product;
+}
+
+// Product mod NUM_LIMIT of the file's elements through the pool, reading through a read-only mapping, -1 on an error
+static int ProdFileMmap(ProdPool *pool, const char *path, int width, ProdFileStats *stats) {
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    *stats = (ProdFileStats) { 0, 0.0, 0.0, 0.0 };
+    long long count = st.st_size / width;
+    if (count == 0) {
+        close(fd);
+        return 1;                                                   // Empty product
+    }
+    char *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);                                                      // The mapping keeps the file open
+    if (map == MAP_FAILED) {
+        perror(path);
+        return -1;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    int *reduced = NULL;                                            // Writable copy for a window with out-of-range elements
+    uint32_t product = 1;
+    long window = PROD_FILE_WINDOW / width;
+    double start = ProdFileSeconds();
+    for (long long first = 0; first < count && product != 0; first += window) {
+        long long last = first + window - 1 < count - 1 ? first + window - 1 : count - 1;
+        size_t offset = (size_t) first * width;
+        if (offset + PROD_FILE_WINDOW < (size_t) st.st_size) {
+            size_t ahead = st.st_size - (offset + PROD_FILE_WINDOW);
+            madvise(map + offset + PROD_FILE_WINDOW, ahead < PROD_FILE_WINDOW ? ahead : PROD_FILE_WINDOW, MADV_WILLNEED);
+        }
+        long n = (long) (last - first + 1);
+        if (width == sizeof(int) && !ProdFileInRange((const int *) (map + offset), n)) {
+            if (reduced == NULL && (reduced = malloc(PROD_FILE_WINDOW)) == NULL) {
+                fprintf(stderr, "Unable to allocate the reduction buffer\n");
+                munmap(map, st.st_size);
+                return -1;
+            }
+            ProdFileReduce(reduced, (const int *) (map + offset), n);   // The mapping is read-only
+            pool->data = ProdFileArray(reduced, width);
+            product = ProdReduce(product * (uint32_t) ProdPoolQuery(pool, 0, n - 1));
+        } else {
+            pool->data = ProdFileArray(map, width);
+            product = ProdReduce(product * (uint32_t) ProdPoolQuery(pool, first, last));
+        }
+        madvise(map + offset, (size_t) n * width, MADV_DONTNEED);   // Clean file pages, dropping them loses nothing
+        stats->elements += n;
+    }
+    stats->seconds = ProdFileSeconds() - start;
+
+    free(reduced);
+    munmap(map, st.st_size);
+    return (int) product;
+}
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef PROD_INDEX_H
+#define PROD_INDEX_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "prod_kernels.h"
+
+/*
+* Range product index
+* A segment tree over blocks of PROD_INDEX_BLOCK elements. Every node keeps the product of the non-zero elements
+* below it mod NUM_LIMIT, and separately how many of them are zero: zero has no inverse mod NUM_LIMIT, so tracking it
+* in the product would lose everything else in that subtree for good once the zero is overwritten.
+* An element that is a multiple of NUM_LIMIT counts as a zero too, it multiplies the product to zero all the same.
+* Build is O(n), a query is O(PROD_INDEX_BLOCK + log n), a point update O(PROD_INDEX_BLOCK + log n).
+* Elements must satisfy the kernels' bound, 0 <= data[i] < 2^18.
+*/
+
+#define PROD_INDEX_BLOCK 64     // Elements per leaf: a partial leaf is scanned directly, a full one is a single node
+
+typedef struct {
+    ProdArray data;
+    long size;
+    long leaves;                // Power of two >= the number of blocks; node 1 is the root, leaves start at index leaves
+    uint16_t *product;          // Product of the non-zero elements below each node
+    int *zeros;                 // Zero elements below each node
+} ProdIndex;
+
+// Product of the non-zero elements of data[start..end] and how many zeros were skipped, for the leaves and partial blocks
+static uint32_t ProdIndexScan(ProdArray data, long start, long end, int *zeros) {
+    uint32_t product = 1;
+
+    for (long i = start; i <= end; i++) {
+        uint32_t value = ProdElem(data, i) % NUM_LIMIT;
+        if (value == 0) {
+            (*zeros)++;
+        } else {
+            product = ProdReduce(product * value);
+        }
+    }
+    return product;
+}
+
+static void ProdIndexLeaf(ProdIndex *index, long block) {
+    long start = block * PROD_INDEX_BLOCK;
+    long end = start + PROD_INDEX_BLOCK - 1 < index->size - 1 ? start + PROD_INDEX_BLOCK - 1 : index->size - 1;
+    long node = index->leaves + block;
+    int zeros = 0;
+    int product = ProdKernelAt(index->data, start, end - start + 1);
+
+    if (product == 0) {
+        product = (int) ProdIndexScan(index->data, start, end, &zeros);   // NUM_LIMIT is prime: zero only if an element is
+    }
+    index->product[node] = (uint16_t) product;
+    index->zeros[node] = zeros;
+}
+
+static void ProdIndexPull(ProdIndex *index, long node) {
+    index->product[node] = (uint16_t) ProdReduce((uint32_t) index->product[2 * node] * index->product[2 * node + 1]);
+    index->zeros[node] = index->zeros[2 * node] + index->zeros[2 * node + 1];
+}
+
+// Build the index over data[0..size-1], returns -1 if the tree cannot be allocated
+static int ProdIndexBuild(ProdIndex *index, ProdArray data, long size) {
+    long blocks = (size + PROD_INDEX_BLOCK - 1) / PROD_INDEX_BLOCK;
+
+    index->data = data;
+    index->size = size;
+    for (index->leaves = 1; index->leaves < blocks; index->leaves *= 2) {
+        ;
+    }
+    index->product = malloc(2 * index->leaves * sizeof(uint16_t));
+    index->zeros = malloc(2 * index->leaves * sizeof(int));
+    if (index->product == NULL || index->zeros == NULL) {
+        fprintf(stderr, "Unable to allocate the product index\n");
+        free(index->product);
+        free(index->zeros);
+        return -1;
+    }
+    for (long block = 0; block < index->leaves; block++) {
+        if (block < blocks) {
+            ProdIndexLeaf(index, block);
+        } else {
+            index->product[index->leaves + block] = 1;          // Padding leaves are neutral
+            index->zeros[index->leaves + block] = 0;
+        }
+    }
+    for (long node = index->leaves - 1; node >= 1; node--) {
+        ProdIndexPull(index, node);
+    }
+    return 0;
+}
+
+// Product of data[first..last] (inclusive) mod NUM_LIMIT
+static int ProdIndexQuery(const ProdIndex *index, long first, long last) {
+    long firstBlock = first / PROD_INDEX_BLOCK, lastBlock = last / PROD_INDEX_BLOCK;
+    uint32_t product;
+    int zeros = 0;
+
+    if (lastBlock - firstBlock < 2) {
+        product = ProdIndexScan(index->data, first, last, &zeros);   // At most two blocks, cheaper to scan
+        return zeros > 0 ? 0 : (int) product;
+    }
+    // Partial blocks at both ends, then the full blocks in between climbing the tree
+    product = ProdIndexScan(index->data, first, (firstBlock + 1) * PROD_INDEX_BLOCK - 1, &zeros);
+    product = ProdReduce(product * ProdIndexScan(index->data, lastBlock * PROD_INDEX_BLOCK, last, &zeros));
+    for (long lo = index->leaves + firstBlock + 1, hi = index->leaves + lastBlock; lo < hi; lo /= 2, hi /= 2) {
+        if (lo & 1) {
+            zeros += index->zeros[lo];
+            product = ProdReduce(product * index->product[lo++]);
+        }
+        if (hi & 1) {
+            zeros += index->zeros[--hi];
+            product = ProdReduce(product * index->product[hi]);
+        }
+    }
+    return zeros > 0 ? 0 : (int) product;
+}
+
+// data[pos] = value, then refresh its leaf and the path to the root
+static void ProdIndexUpdate(ProdIndex *index, long pos, int value) {
+    long block = pos / PROD_INDEX_BLOCK;
+
+    ProdSetElem(index->data, pos, value);
+    ProdIndexLeaf(index, block);
+    for (long node = (index->leaves + block) / 2; node >= 1; node /= 2) {
+        ProdIndexPull(index, node);
+    }
+}
+
+static void ProdIndexFree(ProdIndex *index) {
+    free(index->product);
+    free(index->zeros);
+    index->product = NULL;
+    index->zeros = NULL;
+}
+
+#endif
@@ -0,0 +1,327 @@
+#ifndef PROD_KERNELS_H
+#define PROD_KERNELS_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <immintrin.h>
+
+/*
+* Modular product kernels
+* The plain loop is one dependency chain with a hardware divide per element. These kernels keep many independent partial
+* products (scalar registers, AVX2 or AVX-512 lanes), replace % NUM_LIMIT with a Barrett reduction by a precomputed
+* reciprocal, and fold the partial products at the end; the modular product is commutative, so the result is the same.
+* Every kernel requires 0 <= data[i] < 2^18, so that a partial product (< NUM_LIMIT < 2^14) times an element fits in 32 bits.
+* The AVX kernels are compiled with target attributes and only called when the CPU reports the instruction set.
+* Every kernel has a 16-bit twin for arrays stored as uint16_t, which moves half the bytes per element; the lanes and the
+* reduction are the same, only the loads widen 16-bit elements instead of 32-bit ones.
+*/
+
+#ifndef NUM_LIMIT
+#define NUM_LIMIT 9973
+#endif
+
+#define PROD_BARRETT_M ((uint32_t) ((1ULL << 32) / NUM_LIMIT))   // floor(2^32 / NUM_LIMIT)
+#define PROD_BLOCK 16384                                          // Elements per kernel call in ProdRange, 64 KB of ints
+
+typedef int (*ProdKernel)(const int *data, long n);             // Product of data[0..n-1] mod NUM_LIMIT
+typedef int (*ProdKernel16)(const uint16_t *data, long n);
+
+// An element array in either storage width: exactly one of the two pointers is set
+typedef struct {
+    int *i32;
+    uint16_t *u16;
+} ProdArray;
+
+// x mod NUM_LIMIT for any x < 2^32: the estimated quotient is low by at most one, so one conditional subtraction finishes it
+static inline uint32_t ProdReduce(uint32_t x) {
+    uint32_t q = (uint32_t) (((uint64_t) x * PROD_BARRETT_M) >> 32);
+    uint32_t r = x - q * NUM_LIMIT;
+    return r >= NUM_LIMIT ? r - NUM_LIMIT : r;
+}
+
+/*************** SCALAR KERNELS ***************/
+// The original loop, kept as the reference the other kernels are checked against
+static int ProdKernelScalar(const int *data, long n) {
+    uint32_t product = 1;
+
+    for (long i = 0; i < n; i++) {
+        product = (product * (uint32_t) data[i]) % NUM_LIMIT;   // Below 9973 * 2^18, no overflow
+    }
+    return (int) product;
+}
+
+// Eight independent chains with Barrett reduction, works on any CPU
+static int ProdKernelBarrett(const int *data, long n) {
+    uint32_t acc[8] = { 1, 1, 1, 1, 1, 1, 1, 1 };
+    uint32_t product = 1;
+    long i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        for (int j = 0; j < 8; j++) {
+            acc[j] = ProdReduce(acc[j] * (uint32_t) data[i + j]);
+        }
+    }
+    for (int j = 0; j < 8; j++) {
+        product = ProdReduce(product * acc[j]);
+    }
+    for (; i < n; i++) {
+        product = ProdReduce(product * (uint32_t) data[i]);
+    }
+    return (int) product;
+}
+
+static int ProdKernelScalar16(const uint16_t *data, long n) {
+    uint32_t product = 1;
+
+    for (long i = 0; i < n; i++) {
+        product = (product * (uint32_t) data[i]) % NUM_LIMIT;   // Below 9973 * 2^18, no overflow
+    }
+    return (int) product;
+}
+
+static int ProdKernelBarrett16(const uint16_t *data, long n) {
+    uint32_t acc[8] = { 1, 1, 1, 1, 1, 1, 1, 1 };
+    uint32_t product = 1;
+    long i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        for (int j = 0; j < 8; j++) {
+            acc[j] = ProdReduce(acc[j] * data[i + j]);
+        }
+    }
+    for (int j = 0; j < 8; j++) {
+        product = ProdReduce(product * acc[j]);
+    }
+    for (; i < n; i++) {
+        product = ProdReduce(product * data[i]);
+    }
+    return (int) product;
+}
+
+/*************** AVX2 KERNEL ***************/
+// One 64-bit lane per partial product: _mm256_mul_epu32 multiplies the low 32 bits of each lane into the full 64
+__attribute__((target("avx2")))
+static inline __m256i ProdMulAVX2(__m256i acc, __m256i elem, __m256i p, __m256i m, __m256i pMinus1) {
+    __m256i x = _mm256_mul_epu32(acc, elem);                                 // < 2^32
+    __m256i q = _mm256_srli_epi64(_mm256_mul_epu32(x, m), 32);
+    __m256i r = _mm256_sub_epi64(x, _mm256_mul_epu32(q, p));                 // In [0, 2p)
+    return _mm256_sub_epi64(r, _mm256_and_si256(_mm256_cmpgt_epi64(r, pMinus1), p));
+}
+
+__attribute__((target("avx2")))
+static int ProdKernelAVX2(const int *data, long n) {
+    const __m256i p = _mm256_set1_epi64x(NUM_LIMIT);
+    const __m256i m = _mm256_set1_epi64x(PROD_BARRETT_M);
+    const __m256i pMinus1 = _mm256_set1_epi64x(NUM_LIMIT - 1);
+    __m256i acc[8];                                                          // 8 vectors x 4 lanes = 32 independent chains
+    uint64_t lanes[4];
+    uint32_t product = 1;
+    long i = 0;
+
+    for (int v = 0; v < 8; v++) {
+        acc[v] = _mm256_set1_epi64x(1);
+    }
+    for (; i + 32 <= n; i += 32) {
+        for (int v = 0; v < 8; v++) {
+            __m256i elem = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *) (data + i + 4 * v)));
+            acc[v] = ProdMulAVX2(acc[v], elem, p, m, pMinus1);
+        }
+    }
+    for (int v = 0; v < 8; v++) {                                            // Fold the lanes
+        _mm256_storeu_si256((__m256i *) lanes, acc[v]);
+        for (int l = 0; l < 4; l++) {
+            product = ProdReduce(product * (uint32_t) lanes[l]);
+        }
+    }
+    for (; i < n; i++) {
+        product = ProdReduce(product * (uint32_t) data[i]);
+    }
+    return (int) product;
+}
+
+__attribute__((target("avx2")))
+static int ProdKernelAVX2_16(const uint16_t *data, long n) {
+    const __m256i p = _mm256_set1_epi64x(NUM_LIMIT);
+    const __m256i m = _mm256_set1_epi64x(PROD_BARRETT_M);
+    const __m256i pMinus1 = _mm256_set1_epi64x(NUM_LIMIT - 1);
+    __m256i acc[8];
+    uint64_t lanes[4];
+    uint32_t product = 1;
+    long i = 0;
+
+    for (int v = 0; v < 8; v++) {
+        acc[v] = _mm256_set1_epi64x(1);
+    }
+    for (; i + 32 <= n; i += 32) {
+        for (int v = 0; v < 8; v++) {
+            __m256i elem = _mm256_cvtepu16_epi64(_mm_loadl_epi64((const __m128i *) (data + i + 4 * v)));   // 4 elements, 8 bytes
+            acc[v] = ProdMulAVX2(acc[v], elem, p, m, pMinus1);
+        }
+    }
+    for (int v = 0; v < 8; v++) {
+        _mm256_storeu_si256((__m256i *) lanes, acc[v]);
+        for (int l = 0; l < 4; l++) {
+            product = ProdReduce(product * (uint32_t) lanes[l]);
+        }
+    }
+    for (; i < n; i++) {
+        product = ProdReduce(product * data[i]);
+    }
+    return (int) product;
+}
+
+/*************** AVX-512 KERNEL ***************/
+__attribute__((target("avx512f")))
+static inline __m512i ProdMulAVX512(__m512i acc, __m512i elem, __m512i p, __m512i m) {
+    __m512i x = _mm512_mul_epu32(acc, elem);
+    __m512i q = _mm512_srli_epi64(_mm512_mul_epu32(x, m), 32);
+    __m512i r = _mm512_sub_epi64(x, _mm512_mul_epu32(q, p));
+    return _mm512_min_epu64(r, _mm512_sub_epi64(r, p));                      // r - p wraps around when r < p, so min picks the reduced value
+}
+
+__attribute__((target("avx512f")))
+static int ProdKernelAVX512(const int *data, long n) {
+    const __m512i p = _mm512_set1_epi64(NUM_LIMIT);
+    const __m512i m = _mm512_set1_epi64(PROD_BARRETT_M);
+    __m512i acc[8];                                                          // 8 vectors x 8 lanes = 64 independent chains
+    uint64_t lanes[8];
+    uint32_t product = 1;
+    long i = 0;
+
+    for (int v = 0; v < 8; v++) {
+        acc[v] = _mm512_set1_epi64(1);
+    }
+    for (; i + 64 <= n; i += 64) {
+        for (int v = 0; v < 8; v++) {
+            __m512i elem = _mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i *) (data + i + 8 * v)));
+            acc[v] = ProdMulAVX512(acc[v], elem, p, m);
+        }
+    }
+    for (int v = 0; v < 8; v++) {
+        _mm512_storeu_si512((void *) lanes, acc[v]);
+        for (int l = 0; l < 8; l++) {
+            product = ProdReduce(product * (uint32_t) lanes[l]);
+        }
+    }
+    for (; i < n; i++) {
+        product = ProdReduce(product * (uint32_t) data[i]);
+    }
+    return (int) product;
+}
+
+__attribute__((target("avx512f")))
+static int ProdKernelAVX512_16(const uint16_t *data, long n) {
+    const __m512i p = _mm512_set1_epi64(NUM_LIMIT);
+    const __m512i m = _mm512_set1_epi64(PROD_BARRETT_M);
+    __m512i acc[8];
+    uint64_t lanes[8];
+    uint32_t product = 1;
+    long i = 0;
+
+    for (int v = 0; v < 8; v++) {
+        acc[v] = _mm512_set1_epi64(1);
+    }
+    for (; i + 64 <= n; i += 64) {
+        for (int v = 0; v < 8; v++) {
+            __m512i elem = _mm512_cvtepu16_epi64(_mm_loadu_si128((const __m128i *) (data + i + 8 * v)));   // 8 elements, 16 bytes
+            acc[v] = ProdMulAVX512(acc[v], elem, p, m);
+        }
+    }
+    for (int v = 0; v < 8; v++) {
+        _mm512_storeu_si512((void *) lanes, acc[v]);
+        for (int l = 0; l < 8; l++) {
+            product = ProdReduce(product * (uint32_t) lanes[l]);
+        }
+    }
+    for (; i < n; i++) {
+        product = ProdReduce(product * data[i]);
+    }
+    return (int) product;
+}
+
+/*************** KERNEL SELECTION ***************/
+typedef struct {
+    const char *name;
+    ProdKernel kernel;
+    ProdKernel16 kernel16;
+    const char *feature;        // __builtin_cpu_supports() name, NULL if any CPU will do
+} ProdKernelInfo;
+
+static const ProdKernelInfo gProdKernels[] = {
+    { "avx512", ProdKernelAVX512, ProdKernelAVX512_16, "avx512f" },
+    { "avx2", ProdKernelAVX2, ProdKernelAVX2_16, "avx2" },
+    { "barrett", ProdKernelBarrett, ProdKernelBarrett16, NULL },
+    { "scalar", ProdKernelScalar, ProdKernelScalar16, NULL }
+};
+
+static ProdKernel gProdKernel = ProdKernelScalar;
+static ProdKernel16 gProdKernel16 = ProdKernelScalar16;
+static const char *gProdKernelName = "scalar";
+
+static bool ProdKernelSupported(const ProdKernelInfo *info) {
+    __builtin_cpu_init();
+    if (info->feature == NULL) {
+        return true;
+    }
+    // __builtin_cpu_supports() only takes string literals
+    return strcmp(info->feature, "avx512f") == 0 ? __builtin_cpu_supports("avx512f") : __builtin_cpu_supports("avx2");
+}
+
+// "auto" picks the widest kernel the CPU runs, returns -1 for an unknown or unsupported name
+static int ProdSelectKernel(const char *name) {
+    int count = sizeof(gProdKernels) / sizeof(gProdKernels[0]);
+
+    for (int k = 0; k < count; k++) {
+        const ProdKernelInfo *info = &gProdKernels[k];
+        if (strcmp(name, "auto") == 0 ? ProdKernelSupported(info) : strcmp(name, info->name) == 0) {
+            if (!ProdKernelSupported(info)) {
+                fprintf(stderr, "This CPU does not support the %s kernel\n", info->name);
+                return -1;
+            }
+            gProdKernel = info->kernel;
+            gProdKernel16 = info->kernel16;
+            gProdKernelName = info->name;
+            return 0;
+        }
+    }
+    fprintf(stderr, "Unknown kernel '%s' (expected auto, avx512, avx2, barrett or scalar)\n", name);
+    return -1;
+}
+
+/*************** ELEMENT ACCESS ***************/
+static inline uint32_t ProdElem(ProdArray data, long i) {
+    return data.u16 != NULL ? data.u16[i] : (uint32_t) data.i32[i];
+}
+
+// A value too wide for 16 bits is stored reduced mod NUM_LIMIT, which leaves every product unchanged
+static inline void ProdSetElem(ProdArray data, long i, int value) {
+    if (data.u16 != NULL) {
+        data.u16[i] = (uint16_t) (value > UINT16_MAX ? value % NUM_LIMIT : value);
+    } else {
+        data.i32[i] = value;
+    }
+}
+
+// Product of data[start..start+n-1] with the selected kernel for the array's width
+static inline int ProdKernelAt(ProdArray data, long start, long n) {
+    return data.u16 != NULL ? gProdKernel16(data.u16 + start, n) : gProdKernel(data.i32 + start, n);
+}
+
+/*************** PRODUCT OF A RANGE ***************/
+// Product of data[start..end] (inclusive, like the division indices) mod NUM_LIMIT, block by block so a zero ends the scan early
+static int ProdRange(ProdArray data, long start, long end) {
+    uint32_t product = 1;
+
+    for (long i = start; i <= end; i += PROD_BLOCK) {
+        long n = end - i + 1 < PROD_BLOCK ? end - i + 1 : PROD_BLOCK;
+        product = ProdReduce(product * (uint32_t) ProdKernelAt(data, i, n));
+        if (product == 0) {
+            break;                              // Zero stays zero, nothing further can change the result
+        }
+    }
+    return (int) product;
+}
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef PROD_POOL_H
+#define PROD_POOL_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+#include "prod_kernels.h"
+
+/*
+* Persistent worker pool for range products
+* The workers are created and pinned once, then sleep on a barrier between queries. A query publishes its range and
+* passes the start barrier, every worker multiplies its share of the range into its own cache-line slot, and the
+* finish barrier hands the slots back to the caller, which folds them. The barriers are reused for every query, so a
+* query costs two barrier crossings instead of creating and joining a thread per division.
+* Requires _GNU_SOURCE before the first system header, for pthread_attr_setaffinity_np.
+*/
+
+#ifndef PROD_POOL_MAX
+#define PROD_POOL_MAX 64
+#endif
+
+typedef struct ProdPool ProdPool;
+
+typedef struct {
+    ProdPool *pool;
+    int index;
+} ProdPoolWorker;
+
+typedef struct {
+    _Alignas(64) int product;   // Written by one worker per query, never shares a line with another worker's slot
+} ProdPoolSlot;
+
+struct ProdPool {
+    ProdArray data;                         // May be replaced between queries, the start barrier publishes it
+    int count;                              // Workers
+    long first, last;                       // Current query, inclusive like the division indices
+    bool quit;                              // Set before the last start barrier, the workers return instead of working
+    pthread_barrier_t start;                // count + 1 waiters: the workers and the caller
+    pthread_barrier_t finish;
+    pthread_t tid[PROD_POOL_MAX];
+    ProdPoolWorker workers[PROD_POOL_MAX];
+    ProdPoolSlot slots[PROD_POOL_MAX];
+};
+
+static void *ProdPoolThread(void *param) {
+    ProdPoolWorker *worker = param;
+    ProdPool *pool = worker->pool;
+
+    for (;;) {
+        pthread_barrier_wait(&pool->start);                // The barrier also makes the caller's range visible
+        if (pool->quit) {
+            return NULL;
+        }
+        // Same split as CalculateIndices: the first (len % count) workers get one extra element
+        long len = pool->last - pool->first + 1;
+        long share = len / pool->count, extra = len % pool->count;
+        long start = pool->first + worker->index * share + (worker->index < extra ? worker->index : extra);
+        long end = start + share + (worker->index < extra ? 1 : 0) - 1;
+        pool->slots[worker->index].product = end >= start ? ProdRange(pool->data, start, end) : 1;
+        pthread_barrier_wait(&pool->finish);
+    }
+}
+
+// The i-th CPU this process may run on, wrapping around, as a one-CPU set; false if the affinity cannot be read
+static bool ProdPoolCpu(int index, cpu_set_t *one) {
+    cpu_set_t allowed;
+    int seen = 0, total;
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || (total = CPU_COUNT(&allowed)) == 0) {
+        return false;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed) && seen++ == index % total) {
+            CPU_ZERO(one);
+            CPU_SET(cpu, one);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Start count pinned workers over data, returns -1 if the threads or barriers cannot be created
+static int ProdPoolInit(ProdPool *pool, ProdArray data, int count) {
+    if (count <= 0 || count > PROD_POOL_MAX) {
+        fprintf(stderr, "Pool size must be between 1 and %d\n", PROD_POOL_MAX);
+        return -1;
+    }
+    pool->data = data;
+    pool->count = count;
+    pool->quit = false;
+    if (pthread_barrier_init(&pool->start, NULL, count + 1) != 0 ||
+        pthread_barrier_init(&pool->finish, NULL, count + 1) != 0) {
+        fprintf(stderr, "Unable to create the pool barriers\n");
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        pthread_attr_t attr;
+        cpu_set_t one;
+        pthread_attr_init(&attr);
+        if (ProdPoolCpu(i, &one)) {
+            pthread_attr_setaffinity_np(&attr, sizeof(one), &one);   // Failing to pin is not an error
+        }
+        pool->workers[i] = (ProdPoolWorker) { pool, i };
+        int rc = pthread_create(&pool->tid[i], &attr, ProdPoolThread, &pool->workers[i]);
+        pthread_attr_destroy(&attr);
+        if (rc != 0) {
+            fprintf(stderr, "Error creating pool thread %d\n", i);
+            return -1;                                      // The workers already started wait on a barrier that never fills
+        }
+    }
+    return 0;
+}
+
+// Start computing the product of data[first..last]; the caller may do other work before ProdPoolWait, but not submit again
+static void ProdPoolSubmit(ProdPool *pool, long first, long last) {
+    pool->first = first;
+    pool->last = last;
+    pthread_barrier_wait(&pool->start);
+}
+
+// Wait for the submitted query and return its product mod NUM_LIMIT
+static int ProdPoolWait(ProdPool *pool) {
+    uint32_t product = 1;
+
+    pthread_barrier_wait(&pool->finish);
+    for (int i = 0; i < pool->count; i++) {
+        product = ProdReduce(product * (uint32_t) pool->slots[i].product);
+    }
+    return (int) product;
+}
+
+static int ProdPoolQuery(ProdPool *pool, long first, long last) {
+    ProdPoolSubmit(pool, first, last);
+    return ProdPoolWait(pool);
+}
+
+// Release the workers from their barrier and join them
+static void ProdPoolDestroy(ProdPool *pool) {
+    pool->quit = true;
+    pthread_barrier_wait(&pool->start);
+    for (int i = 0; i < pool->count; i++) {
+        pthread_join(pool->tid[i], NULL);
+    }
+    pthread_barrier_destroy(&pool->start);
+    pthread_barrier_destroy(&pool->finish);
+}
+
+#endif
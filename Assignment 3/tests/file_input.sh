@@ -0,0 +1,45 @@
+#!/bin/sh
+# Multiplies element files that break the kernels' 0 <= data[i] < 2^18 bound with every kernel and both --io methods.
+# tests/out_of_range.bin holds { 5, -3, 1 << 20, 7 }, then { 9972, 250000, 9971, 260000, 3, 262143 } five times, whose
+# in-range elements near 2^18 overflow a 32-bit signed product; product 1779 mod 9973. A generated file spanning a few
+# windows checks the reduction on the double-buffered and mapped paths too. Run from Assignment 3.
+set -e
+
+bin=$(mktemp -d)
+trap 'rm -rf "$bin"' EXIT
+gcc -O2 -pthread -o "$bin/MTFindProd" MTFindProd.c
+
+# 10M ints, every 997th negative and every 1009th at or above 2^20, product computed mod 9973 alongside
+big_expected=$(python3 - "$bin/big.bin" <<'PY'
+import array, sys
+values = array.array('i', (-i if i % 997 == 0 else (i % 2047 + 1) << 20 if i % 1009 == 0 else i % 9972 + 1
+                           for i in range(1, 10000001)))
+open(sys.argv[1], 'wb').write(values.tobytes())
+product = 1
+for v in values:
+    product = product * (v % 9973) % 9973
+print(product)
+PY
+)
+
+status=0
+check() {
+    for kernel in scalar barrett avx2 avx512; do
+        for io in pread mmap; do
+            if ! out=$("$bin/MTFindProd" 1 4 -1 --input="$1" --io=$io --kernel=$kernel 2>&1); then
+                case $out in
+                    *"does not support"*) continue ;;                  # Kernel not available on this CPU
+                esac
+            fi
+            got=$(echo "$out" | sed -n 's/.*Product = \(-\?[0-9]*\).*/\1/p')
+            if [ "$got" != "$2" ]; then
+                echo "FAIL $1 $kernel $io: got $got, expected $2"
+                status=1
+            fi
+        done
+    done
+}
+check tests/out_of_range.bin 1779
+check "$bin/big.bin" "$big_expected"
+[ $status -eq 0 ] && echo "All file products match"
+exit $status
@@ -15,55 +15,58 @@ OSs Tested on: Linux Only
 #include <sys/mman.h>
 #include <string.h>
 #include <unistd.h>   // for close, ftruncate, usleep
-
-// Size of shared memory block
-// Pass this to ftruncate and mmap
-#define SHM_SIZE 4096
+#include <time.h>
+#include "shm_buffer.h"
+#include "shm_buffer_utils.h"
+#include "shm_log_utils.h"
 
 // Global pointer to the shared memory block
 // This should receive the return value of mmap
 // Don't change this pointer in any function
 void* gShmPtr;
 
-// You won't necessarily need all the functions below
-void SetIn(int);
-void SetOut(int);
-void SetHeaderVal(int, int);
-int GetBufSize();
-int GetItemCnt();
-int GetIn();
-int GetOut();
-int GetHeaderVal(int);
-void WriteAtBufIndex(int, int);
-int ReadAtBufIndex(int);
-
-int main()
+int main(int argc, char* argv[])
 {
-    const char *name = "OS_HW1_EricDelgado"; // Name of shared memory block to be passed to shm_open
+    const char *name; // Name of shared memory block to be passed to shm_open
     int bufSize; // Bounded buffer size
     int itemCnt; // Number of items to be consumed
     int in; // Index of next item to produce
     int out; // Index of next item to consume
 
+        // Parse the options forwarded by the producer
+        // The positional arguments are informational only, the real values come from the shared memory header
+        InitShmOptions(&gShmOptions);
+        for (int i = 1; i < argc; i++) {
+                if (strncmp(argv[i], "--", 2) == 0 && ParseShmOption(argv[i], &gShmOptions) != 0) {
+                        exit(1);
+                }
+        }
+        if (FinalizeShmOptions(&gShmOptions) != 0) {
+                exit(1);
+        }
+        name = gShmOptions.shmName;
+        struct timespec attachStart;
+        clock_gettime(CLOCK_MONOTONIC, &attachStart);
         
         // Write code here to create a shared memory block and map it to gShmPtr
         // Use the above name
         // **Extremely Important: map the shared memory block for both reading and writing 
         // Use PROT_READ | PROT_WRITE
-        int fd = shm_open(name, O_RDWR | O_CREAT, 0666);
+        // The producer has already created the segment, so no O_CREAT
+        size_t pageSize;
+        int fd = OpenShmSegment(name, O_RDWR, &pageSize);
         if (fd == -1) {
-                perror("Failure Point:shm_open; Error creating shared memory...");     // Using perror instead of printf or fprintf since it prints out more info on an error    
+                perror("Failure Point:shm_open; Error opening shared memory...");      // Using perror instead of printf or fprintf since it prints out more info on an error    
                 exit(1);
         }
 
-        // truncate file to set size
-        // ftruncate(fd, SHM_SIZE);
-        // Configure the size of the shared memory object
-        if (ftruncate(fd, SHM_SIZE) == -1) {
-                perror("Failure Point:ftruncate; Unable to resize shared memory...");    // Using perror instead of printf or fprintf since it prints out more info on an error
+        // The producer sized the segment from its buffer size; learn that size instead of truncating it
+        struct stat shmStat;
+        if (fstat(fd, &shmStat) == -1 || (size_t) shmStat.st_size < sizeof(ShmHeader)) {
+                perror("Failure Point:fstat; Unable to get the size of shared memory...");    // Using perror instead of printf or fprintf since it prints out more info on an error
 
                 close(fd);              // Cleans up resources with close(fd) and shm_unlink(name) on ftruncate or mmap failure to prevent leaks and ensure system cleanup.
-                shm_unlink(name);       // Deletes a shared memory object name, and, once all processes have unmapped the object, deallocates and destroys the contents of the associated memory region
+                UnlinkShmSegment(name); // Deletes a shared memory object name, and, once all processes have unmapped the object, deallocates and destroys the contents of the associated memory region
 
                 exit(1);
         }
@@ -71,12 +74,12 @@ int main()
         //map to gShmPtr
         //addr, size, ptro, flags, fd, offset
         // Map the shared memory object for both reading and writing
-        gShmPtr = mmap(NULL, SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        gShmPtr = MapShmSegment(fd, shmStat.st_size);
         if (gShmPtr == MAP_FAILED) {
                 perror("Failure Point:mmap;  Unable to map shared memory... ");         // Using perror instead of printf or fprintf since it prints out more info on an error
                 
                 close(fd);             // Cleans up resources with close(fd) and shm_unlink(name) on ftruncate or mmap failure to prevent leaks and ensure system cleanup.
-                shm_unlink(name);      // Deletes a shared memory object name, and, once all processes have unmapped the object, deallocates and destroys the contents of the associated memory region
+                UnlinkShmSegment(name); // Deletes a shared memory object name, and, once all processes have unmapped the object, deallocates and destroys the contents of the associated memory region
 
                 exit(1);
         }
@@ -88,6 +91,7 @@ int main()
         itemCnt = GetItemCnt(); 
         in = GetIn();           
         out = GetOut();         
+        AttachRing();
 
         // Check that the consumer has read the right values
         printf("Consumer reading: bufSize = %d, itemCnt = %d, in = %d, out = %d\n", bufSize, itemCnt, in, out);
@@ -95,29 +99,84 @@ int main()
         // Write code here to consume all the items produced by the producer
         // Code to consume all the items produced by the producer
         int consumedItems = 0;
-        while (consumedItems < itemCnt) {
-                // Busy-wait if buffer is empty
-                while (GetIn() == out) {
-                        usleep(1000); // Sleep for 1ms to reduce CPU usage
-                        
-                        // Re-check itemCnt in case of any updates indicating all items are produced.
-                        itemCnt = GetItemCnt();
-                        if (consumedItems >= itemCnt) {
-                                // All items have been consumed; exit the loop.
-                                break;
-                        }
+
+        // --persist: carry on after the last item an earlier consumer released
+        if (gShmOptions.persist) {
+                if (!ShmHeaderValid(shmStat.st_size)) {
+                        fprintf(stderr, "Error: %s does not hold a ring this consumer can attach to.\n", name);
+                        exit(1);
                 }
+                consumedItems = RecoverConsumed();
+                atomic_store(&SHM_HEADER->consumerPid, getpid());
+
+                struct timespec attachEnd;
+                clock_gettime(CLOCK_MONOTONIC, &attachEnd);
+                long long us = (attachEnd.tv_sec - attachStart.tv_sec) * 1000000LL + (attachEnd.tv_nsec - attachStart.tv_nsec) / 1000;
+                printf("Consumer attached to %s generation %d at item %d (recovered in %lld us)\n",
+                       name, atomic_load(&SHM_HEADER->generation), consumedItems, us);
+        }
+        char role[32];
+        if (gShmOptions.consumers > 1) {
+                snprintf(role, sizeof(role), "Consumer%d", gShmOptions.procId);
+        } else {
+                snprintf(role, sizeof(role), "Consumer");
+        }
+        LogInit(role, "Consuming");
+
+        // MPMC mode: keep taking items until all itemCnt have been claimed by some consumer
+        while (gShmOptions.queueMode == QUEUE_MPMC && MpmcClaimItem()) {
+                int value;
+                unsigned int pos = MpmcDequeue(&value);
+                LogItem(pos, value, pos % bufSize);
+                consumedItems++;
+        }
 
-                // Make sure we break out of the outer loop if all items are already consumed.
-                if (consumedItems >= itemCnt) {
-                        break;
+        // Byte ring: read every record in place and give its space back once we are done with it
+        while (gShmOptions.queueMode == QUEUE_BYTES && consumedItems < itemCnt) {
+                int len;
+                const int* record = Peek(&len);
+                int offset = (int) ((const char*) record - (const char*) gShmPtr - sizeof(ShmHeader) - sizeof(RecordHeader));
+                for (int k = 0; k < len / (int) sizeof(int); k++) {
+                        LogItem(consumedItems, record[k], offset);
                 }
+                Release();
+                consumedItems++;
+        }
+
+        if (gShmOptions.queueMode != QUEUE_SPSC) {
+                itemCnt = consumedItems;                                        // Our share is done, skip the SPSC loops below
+        }
+        int batchSize = gShmOptions.batchSize;
+        int* batch = batchSize > 1 ? malloc(batchSize * sizeof(int)) : NULL;
+        if (batchSize > 1 && batch == NULL) {
+                perror("Failure Point:malloc; Unable to allocate the batch buffer...");
+                exit(1);
+        }
+
+        // Batched mode: take whatever run is available (up to batchSize) and release it with a single "out" update
+        while (batch != NULL && consumedItems < itemCnt) {
+                int cnt = ReadBatch(batch, itemCnt - consumedItems < batchSize ? itemCnt - consumedItems : batchSize);
+                for (int k = 0; k < cnt; k++) {
+                        LogItem(consumedItems, batch[k], out);
+                        out = (out + 1) % bufSize;
+                        consumedItems++;
+                }
+                if (gShmOptions.persist) {
+                        SaveConsumed(consumedItems);
+                }
+        }
+        free(batch);
+
+        while (consumedItems < itemCnt) {
+                // Wait if buffer is empty
+                // Spins, sleeps or parks on the futex depending on the wait mode; only rereads "in" once the cached copy is used up
+                WaitForItem(out);
 
                 // Read the item from the buffer at index 'out'
                 int value = ReadAtBufIndex(out);
 
                 // Report the consumption of an item
-                printf("Consuming Item %d with value %d at Index %d\n", consumedItems, value, out);
+                LogItem(consumedItems, value, out);
 
                 // Increment the 'out' index and wrap it if necessary
                 out = (out + 1) % bufSize;
@@ -127,91 +186,23 @@ int main()
 
                 // Update the shared 'out' index for the producer to see
                 SetOut(out);
+                if (gShmOptions.persist) {
+                        SaveConsumed(consumedItems);
+                }
+
+                // Wake the producer if it is parked on a full buffer
+                NotifyOutChanged();
         }
 
+        LogClose();
+        LogAddToTotals(&SHM_HEADER->consumedCnt, &SHM_HEADER->consumedSum);
+
      // remove the shared memory segment 
-     if (shm_unlink(name) == -1) {
+     // With several consumers the launcher removes it once all of them are done, with --persist it stays for the next run
+     if (gShmOptions.consumers == 1 && !gShmOptions.persist && UnlinkShmSegment(name) == -1) {
 	printf("Error removing %s\n",name);
 	exit(-1);
      }
 
      return 0;
 }
-
-// Set the value of shared variable "in"
-void SetIn(int val)
-{
-        SetHeaderVal(2, val);
-}
-
-// Set the value of shared variable "out"
-void SetOut(int val)
-{
-        SetHeaderVal(3, val);
-}
-
-// Get the ith value in the header
-int GetHeaderVal(int i)
-{
-        int val;
-        void* ptr = gShmPtr + i*sizeof(int);
-        memcpy(&val, ptr, sizeof(int));
-        return val;
-}
-
-// Set the ith value in the header
-void SetHeaderVal(int i, int val) {
-        // Explicitly checks if gShmPtr is NULL before proceeding
-        if(gShmPtr == NULL)
-        {
-                perror("Failure Point: SetHeadrVal; Shared memory segment not present, cannot proceed to set header value..."); // Using perror instead of printf or fprintf since it prints out more info on an error
-        }
-        else
-        {
-                // gShmPtr points to the beginning of the shared memory segment, cast it to an integer pointer and then move to the ith integer position
-                int* ptr = (int*) gShmPtr + i;
-                *ptr = val; // Write the value to the shared memory
-        }
-}
-
-
-// Get the value of shared variable "bufSize"
-int GetBufSize()
-{       
-        return GetHeaderVal(0);
-}
-
-// Get the value of shared variable "itemCnt"
-int GetItemCnt()
-{
-        return GetHeaderVal(1);
-}
-
-// Get the value of shared variable "in"
-int GetIn()
-{
-        return GetHeaderVal(2);
-}
-
-// Get the value of shared variable "out"
-int GetOut()
-{             
-        return GetHeaderVal(3);
-}
-
-
-// Write the given val at the given index in the bounded buffer 
-void WriteAtBufIndex(int indx, int val)
-{
-        // Skip the four-integer header and go to the given index 
-        void* ptr = gShmPtr + 4*sizeof(int) + indx*sizeof(int);
-	memcpy(ptr, &val, sizeof(int));
-}
-
-// Read the val at the given index in the bounded buffer
-int ReadAtBufIndex(int indx) {
-        int value;  // Will hold (int) position
-        int* ptr = (int*) gShmPtr + 4 + indx; // Calculate the address to access the indx-th integer after skipping a 4-integer-long header in the shared memory.
-        return *ptr; // Read & return the value from the shared memory
-}
-
@@ -17,32 +17,42 @@ OSs Tested on: Linux Only
 #include <sys/mman.h>
 #include <unistd.h>
 #include <sys/types.h>
-
-// Size of shared memory block
-// Pass this to ftruncate and mmap
-#define SHM_SIZE 4096
+#include <signal.h>
+#include <time.h>
+#include "shm_buffer.h"
+#include "shm_buffer_utils.h"
+#include "shm_log_utils.h"
+#include "../common/fast_rand.h"
 
 // Global pointer to the shared memory block
 // This should receive the return value of mmap
 // Don't change this pointer in any function
 void* gShmPtr;
 
+// Generator state of this producer process, see SeedRand()
+RandState gRand;
+
+// --persist: where InitShm found an interrupted run
+bool gResumed;          // Attached to a segment with work left in it
+int gResumeItem;        // First item that still has to be produced
+bool gConsumerAlive;    // The consumer of that run is still running, don't launch a second one
+
 // Function signatures
 void Producer(int, int, int);
+void ProducerBatched(int, int, int);
+void ProducerMpmc(int, int, int, int);
+void ProducerRecords(int, int);
+void RunProducer(int, int, int);
+void ReportTotals();
+void PrintUsage(const char*);
 void InitShm(int, int);
-void SetBufSize(int);
-void SetItemCnt(int);
-void SetIn(int);
-void SetOut(int);
-void SetHeaderVal(int, int);
-int GetBufSize();
-int GetItemCnt();
-int GetIn();
-int GetOut();
-int GetHeaderVal(int);
-void WriteAtBufIndex(int, int);
-int ReadAtBufIndex(int);
+bool ResumeShm(int, size_t, int, int);
+bool ProcessAlive(pid_t);
+int StartProduction(int);
+void SeedRand(int);
+void SeedRandStream(int, int);
 int GetRand(int, int);
+void FillRand(int*, int, int, int);
 
 // Start main program
 int main(int argc, char* argv[])
@@ -52,20 +62,43 @@ int main(int argc, char* argv[])
         int bufSize; // Bounded buffer size
         int itemCnt; // Number of items to be produced
         int randSeed; // Seed for the random number generator 
+        char* positional[3]; // bufSize, itemCnt, randSeed as given on the command line
+        int positionalCnt = 0;
+        char* consumerArgv[argc + 2]; // Arguments forwarded to the consumer, plus its --id
+        char consumerId[32];
 
         // Write code to check the validity of the command-line arguments
+        // Options start with "--" and may appear anywhere, everything else is positional
+        InitShmOptions(&gShmOptions);
+        consumerArgv[0] = "consumer";
+        for (int i = 1; i < argc; i++) {
+                if (strncmp(argv[i], "--", 2) == 0) {
+                        if (ParseShmOption(argv[i], &gShmOptions) != 0) {
+                                exit(1);
+                        }
+                } else {
+                        if (positionalCnt < 3) {
+                                positional[positionalCnt] = argv[i];
+                        }
+                        positionalCnt++;
+                }
+                consumerArgv[i] = argv[i];                      // The consumer sees the same options so both sides wait the same way
+        }
+        consumerArgv[argc] = NULL;
+
         // Check for the correct number of command-line arguments
-        if(argc != 4){
+        if(positionalCnt != 3){
 		fprintf(stderr, "Invalid number of command-line arguments\n");  // Use fprintf to stderr for error messages to ensure they are seen even if stdout is redirected.
+		PrintUsage(argv[0]);
 		exit(1);
         }
-	bufSize = atoi(argv[1]);
-	itemCnt = atoi(argv[2]);
-	randSeed = atoi(argv[3]);
+	bufSize = atoi(positional[0]);
+	itemCnt = atoi(positional[1]);
+	randSeed = atoi(positional[2]);
 	
         // Check the validity of the buffer size
-        if(bufSize < 2 || bufSize > 600){
-                fprintf(stderr, "Error: Buffer size must be between 2 and 600.\n"); // Use fprintf to stderr for error messages to ensure they are seen even if stdout is redirected.
+        if(bufSize < 2 || bufSize > MAX_BUF_SIZE){
+                fprintf(stderr, "Error: Buffer size must be between 2 and %d.\n", MAX_BUF_SIZE); // Use fprintf to stderr for error messages to ensure they are seen even if stdout is redirected.
 
                 exit(1);
         }
@@ -75,31 +108,82 @@ int main(int argc, char* argv[])
 
                 exit(1);
         }  
+        if(FinalizeShmOptions(&gShmOptions) != 0){
+                exit(1);
+        }
+        // Byte ring: bufSize is a byte count, keep it a whole number of record alignment units
+        if(gShmOptions.queueMode == QUEUE_BYTES){
+                bufSize = (bufSize + RECORD_ALIGN - 1) / RECORD_ALIGN * RECORD_ALIGN;
+                int recordLen = gShmOptions.maxRecordInts * sizeof(int);
+                if(recordLen > MaxRecordLen(bufSize)){
+                        fprintf(stderr, "Error: Records of %d bytes need a byte buffer of at least %d bytes.\n", recordLen, 2 * (recordLen + (int) sizeof(RecordHeader)));
+
+                        exit(1);
+                }
+        }
 
         // Function that creates a shared memory segment and initializes its header
         InitShm(bufSize, itemCnt);        
 
-	/* fork a child process */ 
-	pid = fork();
+	/* fork the consumer processes */ 
+	if (gConsumerAlive) {
+		printf("Consumer of the interrupted run is still attached, not launching another\n");
+	}
+	fflush(stdout); // Otherwise every child inherits the unflushed output and prints it again
+	for (int c = 0; c < gShmOptions.consumers && !gConsumerAlive; c++) {
+		pid = fork();
+
+		if (pid < 0) { // error occurred 
+			fprintf(stderr, "Fork Failed\n");
+			exit(1);
+		}
+		else if (pid == 0) { // child process 
+			printf("Launching Consumer \n");
+			snprintf(consumerId, sizeof(consumerId), "--id=%d", c);
+			consumerArgv[argc] = consumerId;
+			consumerArgv[argc + 1] = NULL;
+			fflush(stdout); // exec discards anything still sitting in the stdio buffer
+			execv("./consumer", consumerArgv);
+			perror("Failure Point:execv; Unable to launch ./consumer...");
+			exit(1);
+		}
+	}
 
-	if (pid < 0) { // error occurred 
-		fprintf(stderr, "Fork Failed\n");
-		exit(1);
+	/* fork the extra producer processes, they share the mapping inherited from InitShm */ 
+	for (int p = 1; p < gShmOptions.producers; p++) {
+		pid = fork();
+
+		if (pid < 0) { // error occurred 
+			fprintf(stderr, "Fork Failed\n");
+			exit(1);
+		}
+		else if (pid == 0) { // child process 
+			gShmOptions.procId = p;
+			RunProducer(bufSize, itemCnt, randSeed);
+			exit(0);
+		}
 	}
-	else if (pid == 0) { // child process 
-		printf("Launching Consumer \n");
-		execlp("./consumer", "consumer", argv[1], argv[2], argv[3], (char *)NULL);
+
+	// parent process, parent will wait for the children to complete 
+	printf("Starting Producer (wait mode: %s)\n", WaitModeName(gShmOptions.waitMode));
+
+	// The function that actually implements the production
+	RunProducer(bufSize, itemCnt, randSeed);
+
+	printf("Producer done and waiting for consumer\n");
+	while (wait(NULL) > 0) {
+		// Reap every consumer and extra producer
+	}
+	if (!gConsumerAlive) {
+		printf("Consumer Completed\n");
+	}
+
+	if (gShmOptions.queueMode == QUEUE_MPMC) {
+		ReportTotals();
+	}
+	if (gShmOptions.consumers > 1) {
+		UnlinkShmSegment(gShmOptions.shmName); // A lone consumer removes the segment itself, with several only the launcher knows when all are done
 	}
-	else { // parent process, parent will wait for the child to complete 
-		printf("Starting Producer\n");
-		
-               // The function that actually implements the production
-               Producer(bufSize, itemCnt, randSeed);
-		
-	       printf("Producer done and waiting for consumer\n");
-	       wait(NULL);		
-	       printf("Consumer Completed\n");
-        }
     
         return 0;
 }
@@ -109,23 +193,34 @@ void InitShm(int bufSize, int itemCnt)
 {
         int in = 0;
         int out = 0;
-        const char *name = "OS_HW1_EricDelgado"; //Name of shared memory object to be passed to shm_open
+        const char *name = gShmOptions.shmName; //Name of shared memory object to be passed to shm_open
 
         // Write code here to create a shared memory block and map it to gShmPtr
         // Use the above name.
         // **Extremely Important: map the shared memory block for both reading and writing
         // Use PROT_READ | PROT_WRITE
         // Check for any erros when creating a shared memory block
-        int fd = shm_open(name, O_RDWR | O_CREAT, 0666);
+        size_t pageSize;
+        int fd = OpenShmSegment(name, O_RDWR | O_CREAT, &pageSize);
+        if (fd == -1) {
+                perror("Failure Point:shm_open; Error creating shared memory...");     // Using perror instead of printf or fprintf since it prints out more info on an error
+                exit(1);
+        }
 
         // truncate file to set size
-        // ftruncate(fd, SHM_SIZE);
-        // Configure the size of the shared memory object
-        if (ftruncate(fd, SHM_SIZE) == -1) {
+        // The segment holds the header plus bufSize slots, rounded up to whole (possibly huge) pages
+        size_t shmSize = ShmSegmentSize(bufSize, pageSize);
+
+        // --persist: pick up an interrupted run of the same shape before anything overwrites it
+        if (gShmOptions.persist && ResumeShm(fd, shmSize, bufSize, itemCnt)) {
+                return;
+        }
+
+        if (ftruncate(fd, shmSize) == -1) {
                 perror("Failure Point:ftruncate; Unable to resize shared memory...");    // Using perror instead of printf or fprintf since it prints out more info on an error
 
                 close(fd);              // Cleans up resources with close(fd) and shm_unlink(name) on ftruncate or mmap failure to prevent leaks and ensure system cleanup.
-                shm_unlink(name);       // Deletes a shared memory object name, and, once all processes have unmapped the object, deallocates and destroys the contents of the associated memory region
+                UnlinkShmSegment(name); // Deletes a shared memory object name, and, once all processes have unmapped the object, deallocates and destroys the contents of the associated memory region
 
                 exit(1);
         }
@@ -133,57 +228,128 @@ void InitShm(int bufSize, int itemCnt)
         //map to gShmPtr
         //addr, size, ptro, flags, fd, offset
         // Map the shared memory object for both reading and writing
-        gShmPtr = mmap(NULL, SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        gShmPtr = MapShmSegment(fd, shmSize);
         if (gShmPtr == MAP_FAILED) {
                 perror("Failure Point:mmap;  Unable to map shared memory... ");         // Using perror instead of printf or fprintf since it prints out more info on an error
                 
                 close(fd);             // Cleans up resources with close(fd) and shm_unlink(name) on ftruncate or mmap failure to prevent leaks and ensure system cleanup.
-                shm_unlink(name);      // Deletes a shared memory object name, and, once all processes have unmapped the object, deallocates and destroys the contents of the associated memory region
+                UnlinkShmSegment(name); // Deletes a shared memory object name, and, once all processes have unmapped the object, deallocates and destroys the contents of the associated memory region
 
                 exit(1);
         }
 
         // Write code here to set the values of the four integers in the header
-        // Just call the functions provided below, like this SetBufSize(bufSize);
-        // Initialize header values
-        SetBufSize(bufSize);
-        SetItemCnt(itemCnt);
-        SetIn(0); // Initial index for production is 0
-        SetOut(0); // Initial index for consumption is 0
+        // Initialize header values (and the MPMC slots when that queue is used)
+        InitShmHeader(bufSize, itemCnt);
+}
+
+// Map an existing segment and resume the run in it, false if there is no unfinished run of the same shape
+bool ResumeShm(int fd, size_t shmSize, int bufSize, int itemCnt)
+{
+        struct timespec start, end;
+        struct stat shmStat;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (fstat(fd, &shmStat) == -1 || (size_t) shmStat.st_size != shmSize) {
+                return false;                                                   // New segment (size 0) or a different layout
+        }
+        gShmPtr = MapShmSegment(fd, shmSize);
+        if (gShmPtr == MAP_FAILED) {
+                return false;
+        }
+        if (!ShmHeaderValid(shmSize) || GetBufSize() != bufSize || GetItemCnt() != itemCnt || RecoverConsumed() >= itemCnt) {
+                munmap(gShmPtr, shmSize);                                       // Finished or foreign, start a new run in it
+                return false;
+        }
+
+        gResumed = true;
+        gResumeItem = RecoverProduced();
+        int generation = atomic_fetch_add(&SHM_HEADER->generation, 1) + 1;
+        pid_t consumer = atomic_load(&SHM_HEADER->consumerPid);
+        gConsumerAlive = consumer > 0 && ProcessAlive(consumer);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        long long us = (end.tv_sec - start.tv_sec) * 1000000LL + (end.tv_nsec - start.tv_nsec) / 1000;
+        printf("Resuming %s generation %d: %d of %d items produced, %d consumed (recovered in %lld us)\n",
+               gShmOptions.shmName, generation, gResumeItem, itemCnt, RecoverConsumed(), us);
+        return true;
+}
+
+// Run one producer process: its share of the items, logged under its own name
+void RunProducer(int bufSize, int itemCnt, int randSeed)
+{
+        static char role[32];
+        int id = gShmOptions.procId;
+
+        if (gShmOptions.producers > 1) {
+                snprintf(role, sizeof(role), "Producer%d", id);
+        } else {
+                snprintf(role, sizeof(role), "Producer");
+        }
+
+        LogInit(role, "Producing");
+        if (gShmOptions.queueMode == QUEUE_BYTES) {
+                ProducerRecords(itemCnt, randSeed);
+        } else if (gShmOptions.queueMode == QUEUE_MPMC) {
+                // Split itemCnt as evenly as possible, each producer gets its own random stream
+                int share = itemCnt / gShmOptions.producers + (id < itemCnt % gShmOptions.producers ? 1 : 0);
+                ProducerMpmc(bufSize, share, randSeed, id);
+        } else {
+                Producer(bufSize, itemCnt, randSeed);
+        }
+        LogClose();
+        LogAddToTotals(&SHM_HEADER->producedCnt, &SHM_HEADER->producedSum);
+}
+
+// Compare what all producers put in with what all consumers took out
+void ReportTotals()
+{
+        long long producedCnt = atomic_load(&SHM_HEADER->producedCnt);
+        long long consumedCnt = atomic_load(&SHM_HEADER->consumedCnt);
+        unsigned long long producedSum = atomic_load(&SHM_HEADER->producedSum);
+        unsigned long long consumedSum = atomic_load(&SHM_HEADER->consumedSum);
+
+        printf("Total produced: %lld items, checksum %016llx\n", producedCnt, producedSum);
+        printf("Total consumed: %lld items, checksum %016llx\n", consumedCnt, consumedSum);
+        printf("%s\n", producedCnt == consumedCnt && producedSum == consumedSum ? "Totals match" : "ERROR: totals do not match");
 }
 
 void Producer(int bufSize, int itemCnt, int randSeed)
 {
-        int in = 0;
-        int out = 0;
+        if (gShmOptions.batchSize > 1) {
+                ProducerBatched(bufSize, itemCnt, randSeed);
+                return;
+        }
 
-        srand(randSeed);
+        int first = StartProduction(randSeed);
+        int in = GetIn();
 
         // Write code here to produce itemCnt integer values in the range [0-3000]
         // Use the functions provided below to get/set the values of shared variables "in" and "out"
         // Use the provided function WriteAtBufIndex() to write into the bounded buffer
 
         // Produce itemCnt items
-        for (int i = 0; i < itemCnt; i++) {
+        for (int i = first; i < itemCnt; i++) {
                 // Wait if buffer is full
-                while (((in + 1) % bufSize) == GetOut()) {
-                        // Buffer is full, wait for consumer to consume an itemclear 
-                        usleep(100000); // Sleep for 100ms
-                }
+                // Only rereads "out" from the consumer's cache line when the cached copy says the buffer is full
+                WaitForSpace(in);
 
                 // Generate a random value
+                if (gShmOptions.persist) {
+                        SaveRandState(&gRand, i);
+                }
                 int randValue = GetRand(0, 3000);
 
                 // Write the item to the buffer
                 WriteAtBufIndex(in, randValue);
 
                 // Print production message
-                printf("Producing Item %d with value %d at Index %d\n", i, randValue, in);
+                LogItem(i, randValue, in);
 
                 /* FOR TROUBLE SHOOTING 
                 // Print the number of items currently in the buffer 
                 
-                clout = GetOut(); // Fetch the latest 'out' value
+                int out = GetOut(); // Fetch the latest 'out' value
                 int itemsInBuffer = in >= out ? in - out : bufSize - (out - in);
                 printf("Items in buffer: %d\n", itemsInBuffer);
                 */
@@ -193,104 +359,208 @@ void Producer(int bufSize, int itemCnt, int randSeed)
 
                 // Update the shared variable 'in'
                 SetIn(in);
+                if (gShmOptions.persist) {
+                        SaveProduced(i + 1);
+                }
+
+                // Wake the consumer if it is parked on an empty buffer
+                NotifyInChanged();
         }
 
         printf("Producer Completed\n");
 }
 
-
-// Set the value of shared variable "bufSize"
-void SetBufSize(int val)
+// Same production as Producer(), but generates batchSize values at a time and hands each run over with WriteBatch()
+void ProducerBatched(int bufSize, int itemCnt, int randSeed)
 {
-        SetHeaderVal(0, val);
-}
+        int batchSize = gShmOptions.batchSize;
+        int* batch = malloc(batchSize * sizeof(int));
 
-// Set the value of shared variable "itemCnt"
-void SetItemCnt(int val)
-{
-        SetHeaderVal(1, val);
-}
+        if (batch == NULL) {
+                perror("Failure Point:malloc; Unable to allocate the batch buffer...");
+                exit(1);
+        }
 
-// Set the value of shared variable "in"
-void SetIn(int val)
-{
-        SetHeaderVal(2, val);
+        int first = StartProduction(randSeed);
+        int in = GetIn();
+
+        for (int i = first; i < itemCnt; ) {
+                int cnt = itemCnt - i < batchSize ? itemCnt - i : batchSize;
+
+                // Generate the values of the whole batch first (same sequence as the per-item loop)
+                if (gShmOptions.persist) {
+                        SaveRandState(&gRand, i);
+                }
+                FillRand(batch, cnt, 0, 3000);
+
+                // WriteBatch may accept only part of the run when the buffer is nearly full
+                for (int done = 0; done < cnt; ) {
+                        int written = WriteBatch(batch + done, cnt - done);
+                        for (int k = 0; k < written; k++) {
+                                LogItem(i + done + k, batch[done + k], in);
+                                in = (in + 1) % bufSize;
+                        }
+                        done += written;
+                        if (gShmOptions.persist) {
+                                SaveProduced(i + done);
+                        }
+                }
+                i += cnt;
+        }
+
+        free(batch);
+        printf("Producer Completed\n");
 }
 
-// Set the value of shared variable "out"
-void SetOut(int val)
+
+// Production for the MPMC queue: item numbers are the global queue positions, shared with the consumers' logs
+void ProducerMpmc(int bufSize, int itemCnt, int randSeed, int stream)
 {
-        SetHeaderVal(3, val);
+        SeedRandStream(randSeed, stream);
+
+        for (int i = 0; i < itemCnt; i++) {
+                int randValue = GetRand(0, 3000);
+                unsigned int pos = MpmcEnqueue(randValue);
+                LogItem(pos, randValue, pos % bufSize);
+        }
+
+        printf("Producer Completed\n");
 }
 
-// Get the ith value in the header
-int GetHeaderVal(int i)
+// Production for the byte ring: itemCnt records of 1..maxRecordInts values, each written straight into the mapped buffer
+void ProducerRecords(int itemCnt, int randSeed)
 {
-        int val;
-        void* ptr = gShmPtr + i*sizeof(int);
-        memcpy(&val, ptr, sizeof(int));
-        return val;
-}
+        int offset = 0;
 
-// Set the ith value in the header
-void SetHeaderVal(int i, int val) {
-        // Explicitly checks if gShmPtr is NULL before proceeding
-        if(gShmPtr == NULL)
-        {
-                perror("Failure Point: SetHeadrVal; Shared memory segment not present, cannot proceed to set header value..."); // Using perror instead of printf or fprintf since it prints out more info on an error
-        }
-        else
-        {
-                // gShmPtr points to the beginning of the shared memory segment, cast it to an integer pointer and then move to the ith integer position
-                int* ptr = (int*) gShmPtr + i;
-                *ptr = val; // Write the value to the shared memory
+        SeedRand(randSeed);
+        AttachRing();
+
+        for (int i = 0; i < itemCnt; i++) {
+                int cnt = GetRand(1, gShmOptions.maxRecordInts);
+                int* record = Reserve(cnt * sizeof(int));
+                offset = (int) ((char*) record - (char*) gShmPtr - sizeof(ShmHeader) - sizeof(RecordHeader));
+
+                FillRand(record, cnt, 0, 3000);
+                for (int k = 0; k < cnt; k++) {
+                        LogItem(i, record[k], offset);
+                }
+                Commit();
         }
-}
 
-// Get the value of shared variable "bufSize"
-int GetBufSize()
-{       
-        return GetHeaderVal(0);
+        printf("Producer Completed\n");
 }
 
-// Get the value of shared variable "itemCnt"
-int GetItemCnt()
+// Print the command line syntax, the consumer accepts the same options
+void PrintUsage(const char* prog)
 {
-        return GetHeaderVal(1);
+        fprintf(stderr, "Usage: %s <bufSize> <itemCnt> <randSeed> [options]\n", prog);
+        fprintf(stderr, "  --wait=spin|sleep|futex          How to wait on a full/empty buffer (default sleep)\n");
+        fprintf(stderr, "  --batch=N                        Move up to N items per index update (default 1)\n");
+        fprintf(stderr, "  --hugetlb[=dir]                  Back the segment with huge pages (default dir %s)\n", DEFAULT_HUGETLB_DIR);
+        fprintf(stderr, "  --populate                       Pre-fault the segment with MAP_POPULATE\n");
+        fprintf(stderr, "  --log=text|batched|binary|quiet  How items are reported (default text)\n");
+        fprintf(stderr, "  --quiet                          Same as --log=quiet\n");
+        fprintf(stderr, "  --log-file=prefix                Write batched/binary logs to <prefix>.<role>.txt/.bin\n");
+        fprintf(stderr, "  --queue=spsc|mpmc|bytes          Queue protocol (default spsc), bytes makes bufSize a byte count\n");
+        fprintf(stderr, "  --record-ints=N                  Byte ring records carry 1..N values (default %d)\n", DEFAULT_RECORD_INTS);
+        fprintf(stderr, "  --producers=N --consumers=M      Run N producer and M consumer processes on one segment (implies mpmc)\n");
+        fprintf(stderr, "  --name=NAME                      Shared memory object name (default %s)\n", SHM_NAME);
+        fprintf(stderr, "  --persist                        Keep the segment and resume an interrupted run of the same shape found in it\n");
+        fprintf(stderr, "  --rng=xoshiro|libc               Generator for the values (default xoshiro, libc reproduces rand() output)\n");
 }
 
-// Get the value of shared variable "in"
-int GetIn()
+// A killed consumer whose parent died too can linger as a zombie, which kill(pid, 0) still reports as existing
+bool ProcessAlive(pid_t pid)
 {
-        return GetHeaderVal(2);
-}
+        char path[64];
+        char state = 'Z';
 
-// Get the value of shared variable "out"
-int GetOut()
-{             
-        return GetHeaderVal(3);
+        if (kill(pid, 0) == -1) {
+                return false;
+        }
+        snprintf(path, sizeof(path), "/proc/%d/stat", (int) pid);
+        FILE* stat = fopen(path, "r");
+        if (stat == NULL) {
+                return false;
+        }
+        if (fscanf(stat, "%*d (%*[^)]) %c", &state) != 1) {
+                state = 'Z';
+        }
+        fclose(stat);
+        return state != 'Z' && state != 'X';
 }
 
+// Seed the generator and attach to the ring, returns the first item to produce
+// After a resume that is the first item the interrupted run had not published, and the generator is
+// brought to the state it had right before that item: from the saved checkpoint, or from the seed for --rng=libc
+int StartProduction(int randSeed)
+{
+        SeedRand(randSeed);
+        AttachRing();
+        if (!gShmOptions.persist) {
+                return 0;
+        }
+        atomic_store(&SHM_HEADER->producerPid, getpid());
+        if (!gResumed) {
+                return 0;
+        }
 
-// Write the given val at the given index in the bounded buffer 
-void WriteAtBufIndex(int indx, int val)
+        RandState saved;
+        int from = gShmOptions.randMode == RAND_XOSHIRO ? LoadRandState(&saved) : -1;
+        if (from >= 0 && from <= gResumeItem) {
+                gRand = saved;
+        } else {
+                from = 0;                                                       // No usable checkpoint, replay from the seed
+        }
+        for (int i = from; i < gResumeItem; i++) {
+                GetRand(0, 3000);                                               // Values already in the ring
+        }
+        return gResumeItem;
+}
+
+// Start this process's value stream from randSeed
+void SeedRand(int randSeed)
 {
-        // Skip the four-integer header and go to the given index 
-        void* ptr = gShmPtr + 4*sizeof(int) + indx*sizeof(int);
-	memcpy(ptr, &val, sizeof(int));
+        if (gShmOptions.randMode == RAND_LIBC) {
+                srand(randSeed);
+        } else {
+                RandSeed(&gRand, (unsigned int) randSeed);
+        }
 }
 
-// Read the val at the given index in the bounded buffer
-int ReadAtBufIndex(int indx) {
-        int value;  // Will hold (int) position
-        int* ptr = (int*) gShmPtr + 4 + indx; // Calculate the address to access the indx-th integer after skipping a 4-integer-long header in the shared memory.
-        return *ptr; // Read & return the value from the shared memory
+// Start stream number `stream` of randSeed: the xoshiro state is jumped 2^128 values once per stream, so producers
+// seeded from the same randSeed never overlap; rand() cannot jump, so the libc generator falls back to randSeed + stream
+void SeedRandStream(int randSeed, int stream)
+{
+        if (gShmOptions.randMode == RAND_LIBC) {
+                srand(randSeed + stream);
+                return;
+        }
+        RandSeed(&gRand, (unsigned int) randSeed);
+        for (int i = 0; i < stream; i++) {
+                RandJump(&gRand);
+        }
 }
 
 // Get a random number in the range [x, y]
 int GetRand(int x, int y)
 {
+        if (gShmOptions.randMode == RAND_XOSHIRO) {
+                return RandRange(&gRand, x, y);
+        }
 	int r = rand();
 	r = x + r % (y-x+1);
         return r;
 }
+
+// Fill vals[0..n-1] with random numbers in the range [x, y], same values as n GetRand() calls
+void FillRand(int* vals, int n, int x, int y)
+{
+        if (gShmOptions.randMode == RAND_XOSHIRO) {
+                RandFill(&gRand, vals, n, x, y);
+                return;
+        }
+        for (int i = 0; i < n; i++) {
+                vals[i] = GetRand(x, y);
+        }
+}
@@ -0,0 +1,287 @@
+#ifndef SHM_BUFFER_H
+#define SHM_BUFFER_H
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "../common/fast_rand.h"
+
+// Default name of the shared memory object, --name= picks another one
+#define SHM_NAME "OS_HW1_EricDelgado"
+
+// Identifies a fully initialized segment of this layout, a process only attaches when both match
+#define SHM_MAGIC 0x52494E47u   // "RING"
+#define SHM_VERSION 1
+
+// Largest accepted bounded buffer size (slots)
+// The shared memory block is sized from the requested buffer size, see ShmSegmentSize()
+#define MAX_BUF_SIZE (1 << 28)
+
+// hugetlbfs mount used by --hugetlb when no directory is given
+#define DEFAULT_HUGETLB_DIR "/dev/hugepages"
+
+// Size of a cache line, fields written by different processes are kept on different lines
+#define CACHE_LINE_SIZE 64
+
+// Most producer or consumer processes the launcher will start
+#define MAX_PROCS 64
+
+// Indices accepted by GetHeaderVal/SetHeaderVal
+#define HDR_BUF_SIZE 0
+#define HDR_ITEM_CNT 1
+#define HDR_IN 2
+#define HDR_OUT 3
+#define HDR_PROD_WAITING 4
+#define HDR_CONS_WAITING 5
+
+
+/*
+* Which queue protocol the bounded buffer uses
+*   QUEUE_SPSC: one producer, one consumer, "in"/"out" indices and plain int slots
+*   QUEUE_MPMC: any number of each, MpmcSlot slots with per-slot sequence numbers
+*   QUEUE_BYTES: one producer, one consumer, variable-length records built and read in place (bufSize is in bytes)
+*/
+typedef enum {
+    QUEUE_SPSC,
+    QUEUE_MPMC,
+    QUEUE_BYTES
+} QueueMode;
+
+/*
+* Record header in the byte ring, the payload follows it
+* Records start on 8-byte boundaries; a header with len == RECORD_WRAP means "continue at offset 0",
+* used when a record does not fit in what is left before the end of the buffer.
+*/
+typedef struct {
+    unsigned int len;           // Payload bytes
+    unsigned int pad;           // Keeps the payload 8-byte aligned
+} RecordHeader;
+
+#define RECORD_WRAP 0xFFFFFFFFu
+#define RECORD_ALIGN 8
+
+// Default and largest number of ints per record the producer writes in QUEUE_BYTES mode
+#define DEFAULT_RECORD_INTS 16
+#define MAX_RECORD_INTS 65536
+
+/*
+* One slot of the MPMC ring (Vyukov's bounded queue)
+* For position pos mapping to this slot: seq == pos means free for the producer claiming pos,
+* seq == pos + 1 means it holds the item for the consumer claiming pos, and the consumer then
+* sets seq = pos + bufSize to hand it to the producer of the next lap.
+*/
+typedef struct {
+    atomic_uint seq;            // Also the futex word a blocked producer/consumer parks on
+    int value;
+} MpmcSlot;
+
+
+/*
+* Producer generator state saved for --persist, two copies so one is always complete
+* state is the generator right before producing item number items
+*/
+typedef struct {
+    RandState state;
+    int items;
+} RandCheckpoint;
+
+
+/*
+* Header at the start of the shared memory block, the bounded buffer follows it
+* "in" is only written by the producer and "out" only by the consumer, so each gets its own cache line
+* and the two sides no longer invalidate each other's line on every item.
+* Each waiting flag sits next to the index its owner waits on: the side that moves that index
+* already has the line in its cache when it checks whether anybody needs a wakeup.
+* The MPMC fields follow the same rule: the producers' claim counter and the consumers' claim counter
+* live on separate lines, each with the waiter count the other side has to check.
+* The progress fields used by --persist are only ever written by the side that owns the line they are on.
+*/
+typedef struct {
+    alignas(CACHE_LINE_SIZE) atomic_int bufSize;   // Read-only after InitShm
+    atomic_int itemCnt;
+    atomic_int queueMode;
+    atomic_uint magic;                             // SHM_MAGIC, stored last once the rest of the header is valid
+    atomic_int version;                            // SHM_VERSION of the process that initialized the segment
+    atomic_int generation;                         // Bumped every time a producer initializes or reattaches to the segment
+
+    alignas(CACHE_LINE_SIZE) atomic_int in;        // Written by the producer (release), read by the consumer (acquire)
+    atomic_int consWaiting;                        // Consumer is parked on "in"
+    atomic_int producedItems;                      // --persist: items published so far, may trail "in" by what the producer was publishing when it died
+    atomic_int producerPid;                        // --persist: last process that produced into the segment
+    atomic_int randSlot;                           // --persist: which randCheckpoint entry is current
+    RandCheckpoint randCheckpoint[2];
+
+    alignas(CACHE_LINE_SIZE) atomic_int out;       // Written by the consumer (release), read by the producer (acquire)
+    atomic_int prodWaiting;                        // Producer is parked on "out"
+    atomic_int consumedItems;                      // --persist: items released so far, may trail "out" the same way
+    atomic_int consumerPid;                        // --persist: last process that consumed from the segment
+
+    alignas(CACHE_LINE_SIZE) atomic_uint enqueuePos;   // MPMC: next position a producer will claim
+    atomic_int mpmcConsWaiting;                        // MPMC: consumers parked on an empty slot
+
+    alignas(CACHE_LINE_SIZE) atomic_uint dequeuePos;   // MPMC: next position a consumer will claim
+    atomic_int mpmcProdWaiting;                        // MPMC: producers parked on a full slot
+    atomic_int claimedItems;                           // MPMC: items promised to consumers so far, a consumer stops once this passes itemCnt
+
+    alignas(CACHE_LINE_SIZE) atomic_llong producedCnt; // Totals added by every process at exit, checked by the launcher
+    atomic_ullong producedSum;
+    atomic_llong consumedCnt;
+    atomic_ullong consumedSum;
+} ShmHeader;
+
+#define SHM_HEADER ((ShmHeader*) gShmPtr)
+
+
+/*
+* How a side of the bounded buffer waits when it cannot make progress
+*   WAIT_SPIN:  busy-poll the other side's index
+*   WAIT_SLEEP: poll with usleep() between checks (original behavior)
+*   WAIT_FUTEX: park on a futex on the other side's index word and get woken when it changes
+*/
+typedef enum {
+    WAIT_SPIN,
+    WAIT_SLEEP,
+    WAIT_FUTEX
+} WaitMode;
+
+
+/*
+* How produced/consumed items are reported
+*   LOG_TEXT:    one printf per item (original behavior)
+*   LOG_BATCHED: the same lines formatted into a large buffer, written out by a background thread
+*   LOG_BINARY:  fixed-size ItemRecord structs into <logFile>.<role>.bin, written out by a background thread
+*   LOG_QUIET:   nothing per item, only the summary count and checksum
+*/
+typedef enum {
+    LOG_TEXT,
+    LOG_BATCHED,
+    LOG_BINARY,
+    LOG_QUIET
+} LogMode;
+
+// One entry of a LOG_BINARY file
+typedef struct {
+    int item;                   // Sequence number of the item
+    int value;                  // Produced/consumed value
+    int indx;                   // Buffer slot it went through
+} ItemRecord;
+
+// Size of each of the two log buffers, one is being filled while the other is written out
+#define LOG_BUF_SIZE (1 << 20)
+
+
+/*
+* Generator behind the produced values
+*   RAND_XOSHIRO: xoshiro256** from fast_rand.h, seeded from randSeed
+*   RAND_LIBC:    srand(randSeed)/rand() % range, reproduces the values of the original producer
+*/
+typedef enum {
+    RAND_XOSHIRO,
+    RAND_LIBC
+} RandMode;
+
+
+/*
+* Options shared by producer and consumer
+* The producer forwards its options to the consumer so both sides agree
+*/
+typedef struct {
+    WaitMode waitMode;          // Strategy used when the buffer is full (producer) or empty (consumer)
+    int batchSize;              // Items moved per WriteBatch/ReadBatch call, "in"/"out" is published once per batch
+    const char* hugetlbDir;     // hugetlbfs mount to create the segment in, NULL for a regular shm_open segment
+    bool populate;              // Pre-fault the whole mapping with MAP_POPULATE
+    LogMode logMode;            // How items are reported
+    const char* logFile;        // Output file prefix for LOG_BATCHED (optional, stdout otherwise) and LOG_BINARY
+    QueueMode queueMode;        // Queue protocol, forced to QUEUE_MPMC when more than one producer or consumer is requested
+    int producers;              // Producer processes the launcher runs
+    int consumers;              // Consumer processes the launcher runs
+    int procId;                 // Which producer/consumer this process is, 0 for the first one
+    int maxRecordInts;          // QUEUE_BYTES: each record holds 1..maxRecordInts values
+    RandMode randMode;          // Producer only: generator for the item values
+    const char* shmName;        // Name of the shared memory object
+    bool persist;               // Keep the segment after the run and resume an interrupted run found in it
+} ShmOptions;
+
+// Largest accepted --batch value
+#define MAX_BATCH_SIZE 65536
+
+
+// Global pointer to the shared memory block
+// This should receive the return value of mmap
+// Don't change this pointer in any function
+extern void* gShmPtr;
+extern ShmOptions gShmOptions;
+
+// Option handling
+void InitShmOptions(ShmOptions*);
+int ParseShmOption(const char*, ShmOptions*);   // Returns 0 if the argument was a valid option, -1 otherwise
+int FinalizeShmOptions(ShmOptions*);            // Check and resolve option combinations, -1 if they conflict
+const char* WaitModeName(WaitMode);
+
+// Segment setup
+size_t ShmSegmentSize(int, size_t);            // Bytes needed for the header and bufSize slots, rounded up to the page size
+int OpenShmSegment(const char*, int, size_t*); // shm_open or hugetlbfs open, also reports the page size backing the segment
+void* MapShmSegment(int, size_t);              // mmap with the --populate/--hugetlb flags applied, MAP_FAILED on error
+int UnlinkShmSegment(const char*);             // Remove whichever object OpenShmSegment opened
+
+// Persistent segment (--persist)
+bool ShmHeaderValid(size_t);            // Segment of the given size carries a complete header of this layout version
+int RecoverProduced();                  // Items the producer had published, rebuilt from the saved count and "in"
+int RecoverConsumed();                  // Items the consumer had released, rebuilt from the saved count and "out"
+void SaveProduced(int);                 // Producer: record the number of items published
+void SaveConsumed(int);                 // Consumer: record the number of items released
+void SaveRandState(const RandState*, int);      // Producer: record the generator state before producing item n
+int LoadRandState(RandState*);                  // Producer: restore the last saved state, returns the item it belongs to
+
+// Header accessors
+void InitShmHeader(int, int);   // Set up a freshly created segment for bufSize slots and itemCnt items, publishes the magic last
+void SetBufSize(int);
+void SetItemCnt(int);
+void SetIn(int);
+void SetOut(int);
+void SetHeaderVal(int, int);
+int GetBufSize();
+int GetItemCnt();
+int GetIn();
+int GetOut();
+int GetHeaderVal(int);
+
+// Bounded buffer accessors
+void WriteAtBufIndex(int, int);
+int ReadAtBufIndex(int);
+
+// Lock-free single-producer/single-consumer ring on top of the accessors above
+void AttachRing();              // Load the process-local copies of bufSize, "in" and "out" after mapping the block
+void WaitForSpace(int);         // Producer: block until the slot at the given "in" may be written
+void WaitForItem(int);          // Consumer: block until the slot at the given "out" holds an item
+int WriteBatch(const int*, int);        // Producer: copy up to n items in, publish "in" once, returns the number written (>= 1)
+int ReadBatch(int*, int);               // Consumer: copy up to max items out, publish "out" once, returns the number read (>= 1)
+
+// Item logging (shm_log_utils.h)
+void LogInit(const char*, const char*);       // Role name ("Producer") and verb ("Producing")
+void LogItem(int, int, int);                  // Item number, value, buffer index
+void LogClose();                              // Flush everything and print the summary count and checksum
+void LogAddToTotals(atomic_llong*, atomic_ullong*);   // Add this process's count and checksum to totals in the shm header
+
+// Multi-producer/multi-consumer ring
+void InitMpmc();                // Producer: set every slot's sequence number before anybody attaches
+unsigned int MpmcEnqueue(int);  // Producer: block until a slot is free, store the value, returns the position used
+unsigned int MpmcDequeue(int*); // Consumer: block until the next claimed slot is full, returns the position read
+bool MpmcClaimItem();           // Consumer: reserve one of the itemCnt items, false once all are taken
+
+// Variable-length record ring (QUEUE_BYTES), same "in"/"out" words, counted in bytes
+int MaxRecordLen(int);       // Largest payload Reserve accepts for a byte ring of the given capacity
+void* Reserve(int);             // Producer: block until len contiguous payload bytes are free, returns where to build the record
+void Commit();                  // Producer: publish the reserved record
+const void* Peek(int*);         // Consumer: block until a record is there, returns it in place and sets its length
+void Release();                 // Consumer: hand the peeked record's space back to the producer
+
+// Waiting and waking
+void WaitForOutChange(int);     // Producer: block until "out" differs from the given value
+void WaitForInChange(int);      // Consumer: block until "in" differs from the given value
+void NotifyInChanged();         // Producer: wake the consumer after publishing "in"
+void NotifyOutChanged();        // Consumer: wake the producer after publishing "out"
+
+
+#endif
@@ -0,0 +1,868 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <linux/magic.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/vfs.h>
+#include "shm_buffer.h"
+
+ShmOptions gShmOptions;
+
+// Process-local view of the ring
+// Each side keeps its last observation of the other side's index and only touches the other side's
+// cache line again when that stale copy says the buffer is full (producer) or empty (consumer).
+static int gRingBufSize;
+static int gCachedIn;           // Consumer's copy of "in"
+static int gCachedOut;          // Producer's copy of "out"
+static int gRingIn;             // Producer's own "in" as used by WriteBatch
+static int gRingOut;            // Consumer's own "out" as used by ReadBatch
+static bool gShmOnHugetlb;      // OpenShmSegment ended up on hugetlbfs rather than /dev/shm
+static int gReservedEnd;        // Byte ring: where "in" moves to on Commit()
+static int gPeekedEnd;          // Byte ring: where "out" moves to on Release()
+
+/***** CPU RELAX *****/
+// Hint to the CPU that we are in a spin loop (frees the pipeline for an SMT sibling)
+// The memory clobber also stops the compiler from hoisting the index reads out of the loop
+static inline void CpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+        __asm__ __volatile__("pause" ::: "memory");
+#else
+        __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+/***** FUTEX WRAPPERS *****/
+// Not FUTEX_PRIVATE_FLAG: the futex word lives in memory shared between two processes
+static void FutexWait(void* addr, int expected)
+{
+        syscall(SYS_futex, (int*) addr, FUTEX_WAIT, expected, NULL, NULL, 0);  // Returns at once if *addr != expected, so a change between our check and the call is not lost
+}
+
+static void FutexWake(void* addr)
+{
+        syscall(SYS_futex, (int*) addr, FUTEX_WAKE, 1, NULL, NULL, 0);       // Only one waiter can exist per word (one producer, one consumer)
+}
+
+/***** OPTIONS *****/
+void InitShmOptions(ShmOptions* opts)
+{
+        opts->waitMode = WAIT_SLEEP;    // Original behavior
+        opts->batchSize = 1;            // One item per handoff, like the original loop
+        opts->hugetlbDir = NULL;
+        opts->populate = false;
+        opts->logMode = LOG_TEXT;
+        opts->logFile = NULL;
+        opts->queueMode = QUEUE_SPSC;
+        opts->producers = 1;
+        opts->consumers = 1;
+        opts->procId = 0;
+        opts->maxRecordInts = DEFAULT_RECORD_INTS;
+        opts->randMode = RAND_XOSHIRO;
+        opts->shmName = SHM_NAME;
+        opts->persist = false;
+}
+
+int ParseShmOption(const char* arg, ShmOptions* opts)
+{
+        if (strncmp(arg, "--wait=", 7) == 0) {
+                const char* mode = arg + 7;
+                if (strcmp(mode, "spin") == 0) {
+                        opts->waitMode = WAIT_SPIN;
+                } else if (strcmp(mode, "sleep") == 0) {
+                        opts->waitMode = WAIT_SLEEP;
+                } else if (strcmp(mode, "futex") == 0) {
+                        opts->waitMode = WAIT_FUTEX;
+                } else {
+                        fprintf(stderr, "Error: Unknown wait mode '%s' (expected spin, sleep or futex).\n", mode);
+                        return -1;
+                }
+                return 0;
+        }
+
+        if (strncmp(arg, "--batch=", 8) == 0) {
+                opts->batchSize = atoi(arg + 8);
+                if (opts->batchSize < 1 || opts->batchSize > MAX_BATCH_SIZE) {
+                        fprintf(stderr, "Error: Batch size must be between 1 and %d.\n", MAX_BATCH_SIZE);
+                        return -1;
+                }
+                return 0;
+        }
+
+        if (strcmp(arg, "--hugetlb") == 0) {
+                opts->hugetlbDir = DEFAULT_HUGETLB_DIR;
+                return 0;
+        }
+        if (strncmp(arg, "--hugetlb=", 10) == 0) {
+                opts->hugetlbDir = arg + 10;
+                return 0;
+        }
+        if (strcmp(arg, "--populate") == 0) {
+                opts->populate = true;
+                return 0;
+        }
+
+        if (strncmp(arg, "--log=", 6) == 0) {
+                const char* mode = arg + 6;
+                if (strcmp(mode, "text") == 0) {
+                        opts->logMode = LOG_TEXT;
+                } else if (strcmp(mode, "batched") == 0) {
+                        opts->logMode = LOG_BATCHED;
+                } else if (strcmp(mode, "binary") == 0) {
+                        opts->logMode = LOG_BINARY;
+                } else if (strcmp(mode, "quiet") == 0) {
+                        opts->logMode = LOG_QUIET;
+                } else {
+                        fprintf(stderr, "Error: Unknown log mode '%s' (expected text, batched, binary or quiet).\n", mode);
+                        return -1;
+                }
+                return 0;
+        }
+        if (strcmp(arg, "--quiet") == 0) {
+                opts->logMode = LOG_QUIET;
+                return 0;
+        }
+        if (strncmp(arg, "--log-file=", 11) == 0) {
+                opts->logFile = arg + 11;
+                return 0;
+        }
+
+        if (strncmp(arg, "--queue=", 8) == 0) {
+                const char* mode = arg + 8;
+                if (strcmp(mode, "spsc") == 0) {
+                        opts->queueMode = QUEUE_SPSC;
+                } else if (strcmp(mode, "mpmc") == 0) {
+                        opts->queueMode = QUEUE_MPMC;
+                } else if (strcmp(mode, "bytes") == 0) {
+                        opts->queueMode = QUEUE_BYTES;
+                } else {
+                        fprintf(stderr, "Error: Unknown queue mode '%s' (expected spsc, mpmc or bytes).\n", mode);
+                        return -1;
+                }
+                return 0;
+        }
+        if (strncmp(arg, "--producers=", 12) == 0 || strncmp(arg, "--consumers=", 12) == 0) {
+                int cnt = atoi(arg + 12);
+                if (cnt < 1 || cnt > MAX_PROCS) {
+                        fprintf(stderr, "Error: Producer/consumer count must be between 1 and %d.\n", MAX_PROCS);
+                        return -1;
+                }
+                if (arg[2] == 'p') {
+                        opts->producers = cnt;
+                } else {
+                        opts->consumers = cnt;
+                }
+                return 0;
+        }
+        if (strncmp(arg, "--record-ints=", 14) == 0) {
+                opts->maxRecordInts = atoi(arg + 14);
+                if (opts->maxRecordInts < 1 || opts->maxRecordInts > MAX_RECORD_INTS) {
+                        fprintf(stderr, "Error: Record size must be between 1 and %d ints.\n", MAX_RECORD_INTS);
+                        return -1;
+                }
+                return 0;
+        }
+        if (strncmp(arg, "--rng=", 6) == 0) {
+                const char* mode = arg + 6;
+                if (strcmp(mode, "xoshiro") == 0) {
+                        opts->randMode = RAND_XOSHIRO;
+                } else if (strcmp(mode, "libc") == 0) {
+                        opts->randMode = RAND_LIBC;
+                } else {
+                        fprintf(stderr, "Error: Unknown generator '%s' (expected xoshiro or libc).\n", mode);
+                        return -1;
+                }
+                return 0;
+        }
+        if (strncmp(arg, "--name=", 7) == 0) {
+                opts->shmName = arg + 7;
+                if (opts->shmName[0] == '\0' || strchr(opts->shmName, '/') != NULL) {
+                        fprintf(stderr, "Error: Segment name must be non-empty and must not contain '/'.\n");
+                        return -1;
+                }
+                return 0;
+        }
+        if (strcmp(arg, "--persist") == 0) {
+                opts->persist = true;
+                return 0;
+        }
+        if (strncmp(arg, "--id=", 5) == 0) {
+                opts->procId = atoi(arg + 5);                                   // Added by the launcher for each consumer it starts
+                return 0;
+        }
+
+        fprintf(stderr, "Error: Unknown option '%s'.\n", arg);
+        return -1;
+}
+
+// Resolve combinations once everything is parsed, producer and consumer both call this
+int FinalizeShmOptions(ShmOptions* opts)
+{
+        if (opts->producers > 1 || opts->consumers > 1) {
+                if (opts->queueMode == QUEUE_BYTES) {
+                        fprintf(stderr, "Error: The byte ring supports one producer and one consumer only.\n");
+                        return -1;
+                }
+                opts->queueMode = QUEUE_MPMC;                                   // The SPSC index protocol breaks with a second writer or reader
+        }
+        if (opts->queueMode != QUEUE_SPSC && opts->batchSize > 1) {
+                fprintf(stderr, "Error: --batch is only supported with the SPSC queue.\n");
+                return -1;
+        }
+        if (opts->queueMode != QUEUE_SPSC && opts->persist) {
+                fprintf(stderr, "Error: --persist is only supported with the SPSC queue.\n");
+                return -1;
+        }
+        return 0;
+}
+
+const char* WaitModeName(WaitMode mode)
+{
+        switch (mode) {
+        case WAIT_SPIN:  return "spin";
+        case WAIT_SLEEP: return "sleep";
+        case WAIT_FUTEX: return "futex";
+        }
+        return "unknown";
+}
+
+
+/***** SEGMENT SETUP *****/
+size_t ShmSegmentSize(int bufSize, size_t pageSize)
+{
+        size_t slotSize = gShmOptions.queueMode == QUEUE_MPMC ? sizeof(MpmcSlot) : gShmOptions.queueMode == QUEUE_BYTES ? 1 : sizeof(int);
+        size_t bytes = sizeof(ShmHeader) + (size_t) bufSize * slotSize;
+        return (bytes + pageSize - 1) / pageSize * pageSize;                    // ftruncate/mmap on hugetlbfs need whole huge pages
+}
+
+/*
+* With --hugetlb the segment is a file in a hugetlbfs mount, so every mapping of it is backed by huge pages
+* and a large ring costs one TLB entry per 2MB instead of per 4KB.
+* If the directory is not hugetlbfs (or not there) we fall back to a normal shm_open segment
+* and ask for transparent huge pages in MapShmSegment instead.
+*/
+int OpenShmSegment(const char* name, int oflags, size_t* pageSize)
+{
+        gShmOnHugetlb = false;
+
+        if (gShmOptions.hugetlbDir != NULL) {
+                char path[PATH_MAX];
+                struct statfs fsInfo;
+                snprintf(path, sizeof(path), "%s/%s", gShmOptions.hugetlbDir, name);
+
+                int fd = open(path, oflags, 0666);
+                if (fd != -1 && fstatfs(fd, &fsInfo) == 0 && fsInfo.f_type == HUGETLBFS_MAGIC) {
+                        gShmOnHugetlb = true;
+                        *pageSize = fsInfo.f_bsize;                             // The huge page size of this mount
+                        return fd;
+                }
+                if (fd != -1) {
+                        close(fd);
+                        if (oflags & O_CREAT) {
+                                unlink(path);                                   // Don't leave a stray file in a non-hugetlbfs directory
+                        }
+                }
+                if (oflags & O_CREAT) {
+                        fprintf(stderr, "Warning: %s is not a usable hugetlbfs mount, using shm_open with transparent huge pages instead.\n", gShmOptions.hugetlbDir);
+                }
+        }
+
+        *pageSize = sysconf(_SC_PAGESIZE);
+        return shm_open(name, oflags, 0666);
+}
+
+void* MapShmSegment(int fd, size_t size)
+{
+        int flags = MAP_SHARED;
+        if (gShmOptions.populate) {
+                flags |= MAP_POPULATE;                                          // Take all page faults now rather than on first touch in the hot loop
+        }
+
+        void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+        if (ptr != MAP_FAILED && gShmOptions.hugetlbDir != NULL && !gShmOnHugetlb) {
+                madvise(ptr, size, MADV_HUGEPAGE);                              // Best effort, only honored when shmem THP is enabled
+        }
+        return ptr;
+}
+
+int UnlinkShmSegment(const char* name)
+{
+        if (gShmOnHugetlb) {
+                char path[PATH_MAX];
+                snprintf(path, sizeof(path), "%s/%s", gShmOptions.hugetlbDir, name);
+                return unlink(path);
+        }
+        return shm_unlink(name);
+}
+
+
+/***** HEADER INITIALIZATION *****/
+// Called by whoever creates the segment, before any other process attaches
+void InitShmHeader(int bufSize, int itemCnt)
+{
+        atomic_store(&SHM_HEADER->magic, 0);                                    // Nobody attaches to a half initialized header
+        SetBufSize(bufSize);
+        SetItemCnt(itemCnt);
+        SetIn(0); // Initial index for production is 0
+        SetOut(0); // Initial index for consumption is 0
+        SetHeaderVal(HDR_PROD_WAITING, 0); // Nobody is parked on a futex yet
+        SetHeaderVal(HDR_CONS_WAITING, 0);
+        atomic_store(&SHM_HEADER->queueMode, gShmOptions.queueMode);
+        atomic_store(&SHM_HEADER->producedCnt, 0);
+        atomic_store(&SHM_HEADER->producedSum, 0);
+        atomic_store(&SHM_HEADER->consumedCnt, 0);
+        atomic_store(&SHM_HEADER->consumedSum, 0);
+        if (gShmOptions.queueMode == QUEUE_MPMC) {
+                InitMpmc();
+        }
+        atomic_store(&SHM_HEADER->producedItems, 0);
+        atomic_store(&SHM_HEADER->consumedItems, 0);
+        atomic_store(&SHM_HEADER->producerPid, 0);
+        atomic_store(&SHM_HEADER->consumerPid, 0);
+        atomic_store(&SHM_HEADER->randSlot, 0);
+        SHM_HEADER->randCheckpoint[0].items = -1;                               // No saved generator state yet
+        atomic_store(&SHM_HEADER->version, SHM_VERSION);
+        atomic_fetch_add(&SHM_HEADER->generation, 1);                           // Zero on a new segment, counts up when one is reused
+        atomic_store_explicit(&SHM_HEADER->magic, SHM_MAGIC, memory_order_release);
+}
+
+
+/***** PERSISTENT SEGMENT *****/
+bool ShmHeaderValid(size_t shmSize)
+{
+        if (shmSize < sizeof(ShmHeader)) {
+                return false;
+        }
+        if (atomic_load_explicit(&SHM_HEADER->magic, memory_order_acquire) != SHM_MAGIC || atomic_load(&SHM_HEADER->version) != SHM_VERSION) {
+                return false;
+        }
+        int bufSize = GetBufSize();
+        return bufSize >= 2 && bufSize <= MAX_BUF_SIZE && atomic_load(&SHM_HEADER->queueMode) == QUEUE_SPSC &&
+               sizeof(ShmHeader) + (size_t) bufSize * sizeof(int) <= shmSize;
+}
+
+// The saved count is stored after the index is published, so the index can be ahead of it by less than one lap
+static int RecoverCount(int saved, int index, int bufSize)
+{
+        return saved + ((index - saved % bufSize) + bufSize) % bufSize;
+}
+
+int RecoverProduced()
+{
+        return RecoverCount(atomic_load(&SHM_HEADER->producedItems), GetIn(), GetBufSize());
+}
+
+int RecoverConsumed()
+{
+        return RecoverCount(atomic_load(&SHM_HEADER->consumedItems), GetOut(), GetBufSize());
+}
+
+void SaveProduced(int cnt)
+{
+        atomic_store_explicit(&SHM_HEADER->producedItems, cnt, memory_order_release);
+}
+
+void SaveConsumed(int cnt)
+{
+        atomic_store_explicit(&SHM_HEADER->consumedItems, cnt, memory_order_release);
+}
+
+// Write the copy that is not current, then switch to it: a producer dying half way leaves the old copy intact
+void SaveRandState(const RandState* st, int items)
+{
+        int next = atomic_load_explicit(&SHM_HEADER->randSlot, memory_order_relaxed) ^ 1;
+        SHM_HEADER->randCheckpoint[next].state = *st;
+        SHM_HEADER->randCheckpoint[next].items = items;
+        atomic_store_explicit(&SHM_HEADER->randSlot, next, memory_order_release);
+}
+
+int LoadRandState(RandState* st)
+{
+        int slot = atomic_load_explicit(&SHM_HEADER->randSlot, memory_order_acquire);
+        *st = SHM_HEADER->randCheckpoint[slot].state;
+        return SHM_HEADER->randCheckpoint[slot].items;
+}
+
+
+/***** HEADER ACCESSORS *****/
+// Set the value of shared variable "bufSize"
+void SetBufSize(int val)
+{
+        SetHeaderVal(HDR_BUF_SIZE, val);
+}
+
+// Set the value of shared variable "itemCnt"
+void SetItemCnt(int val)
+{
+        SetHeaderVal(HDR_ITEM_CNT, val);
+}
+
+// Set the value of shared variable "in"
+void SetIn(int val)
+{
+        SetHeaderVal(HDR_IN, val);
+}
+
+// Set the value of shared variable "out"
+void SetOut(int val)
+{
+        SetHeaderVal(HDR_OUT, val);
+}
+
+// Map a header index to its field
+static atomic_int* HeaderField(int i)
+{
+        switch (i) {
+        case HDR_BUF_SIZE:     return &SHM_HEADER->bufSize;
+        case HDR_ITEM_CNT:     return &SHM_HEADER->itemCnt;
+        case HDR_IN:           return &SHM_HEADER->in;
+        case HDR_OUT:          return &SHM_HEADER->out;
+        case HDR_PROD_WAITING: return &SHM_HEADER->prodWaiting;
+        case HDR_CONS_WAITING: return &SHM_HEADER->consWaiting;
+        }
+        return NULL;
+}
+
+// Get the ith value in the header
+// Acquire: everything the writer stored before publishing this value is visible afterwards
+int GetHeaderVal(int i)
+{
+        return atomic_load_explicit(HeaderField(i), memory_order_acquire);
+}
+
+// Set the ith value in the header
+// Release: buffer slots written before this call are visible to whoever reads the new value
+void SetHeaderVal(int i, int val) {
+        // Explicitly checks if gShmPtr is NULL before proceeding
+        if(gShmPtr == NULL)
+        {
+                perror("Failure Point: SetHeadrVal; Shared memory segment not present, cannot proceed to set header value..."); // Using perror instead of printf or fprintf since it prints out more info on an error
+        }
+        else
+        {
+                atomic_store_explicit(HeaderField(i), val, memory_order_release); // Write the value to the shared memory
+        }
+}
+
+// Get the value of shared variable "bufSize"
+int GetBufSize()
+{
+        return GetHeaderVal(HDR_BUF_SIZE);
+}
+
+// Get the value of shared variable "itemCnt"
+int GetItemCnt()
+{
+        return GetHeaderVal(HDR_ITEM_CNT);
+}
+
+// Get the value of shared variable "in"
+int GetIn()
+{
+        return GetHeaderVal(HDR_IN);
+}
+
+// Get the value of shared variable "out"
+int GetOut()
+{
+        return GetHeaderVal(HDR_OUT);
+}
+
+
+/***** BOUNDED BUFFER ACCESSORS *****/
+// Write the given val at the given index in the bounded buffer
+void WriteAtBufIndex(int indx, int val)
+{
+        // Skip the header and go to the given index
+        void* ptr = gShmPtr + sizeof(ShmHeader) + indx*sizeof(int);
+	memcpy(ptr, &val, sizeof(int));
+}
+
+// Read the val at the given index in the bounded buffer
+int ReadAtBufIndex(int indx) {
+        int* ptr = (int*) (gShmPtr + sizeof(ShmHeader)) + indx; // Calculate the address to access the indx-th integer after skipping the header in the shared memory.
+        return *ptr; // Read & return the value from the shared memory
+}
+
+
+/***** SPSC RING *****/
+void AttachRing()
+{
+        gRingBufSize = GetBufSize();
+        gCachedIn = GetIn();
+        gCachedOut = GetOut();
+        gRingIn = gCachedIn;
+        gRingOut = gCachedOut;
+}
+
+void WaitForSpace(int in)
+{
+        int next = (in + 1) % gRingBufSize;
+
+        if (next != gCachedOut) {
+                return;                                                         // Fast path: the old copy of "out" already proves there is room
+        }
+        while (next == (gCachedOut = GetOut())) {                              // Looks full, reload the consumer's index
+                WaitForOutChange(gCachedOut);
+        }
+}
+
+void WaitForItem(int out)
+{
+        if (out != gCachedIn) {
+                return;                                                         // Fast path: the old copy of "in" already proves there is an item
+        }
+        while (out == (gCachedIn = GetIn())) {                                 // Looks empty, reload the producer's index
+                WaitForInChange(gCachedIn);
+        }
+}
+
+
+/***** BATCHED TRANSFER *****/
+/*
+* Each batch is at most two memcpy calls (the run up to the end of the buffer and the wrapped rest)
+* followed by a single release store of the index and at most one wakeup,
+* instead of one index store and one wakeup check per item.
+*/
+static int* BufSlot(int indx)
+{
+        return (int*) (gShmPtr + sizeof(ShmHeader)) + indx;
+}
+
+// Copy cnt items into the buffer starting at indx, splitting the copy where the buffer wraps
+static void CopyIntoBuf(int indx, const int* vals, int cnt)
+{
+        int first = gRingBufSize - indx < cnt ? gRingBufSize - indx : cnt;
+        memcpy(BufSlot(indx), vals, first * sizeof(int));
+        memcpy(BufSlot(0), vals + first, (cnt - first) * sizeof(int));
+}
+
+// Copy cnt items out of the buffer starting at indx, splitting the copy where the buffer wraps
+static void CopyFromBuf(int indx, int* vals, int cnt)
+{
+        int first = gRingBufSize - indx < cnt ? gRingBufSize - indx : cnt;
+        memcpy(vals, BufSlot(indx), first * sizeof(int));
+        memcpy(vals + first, BufSlot(0), (cnt - first) * sizeof(int));
+}
+
+int WriteBatch(const int* vals, int n)
+{
+        int free = (gCachedOut - gRingIn - 1 + gRingBufSize) % gRingBufSize;
+
+        if (free < n) {
+                gCachedOut = GetOut();                                          // Cached copy is short of a full batch, one reload per batch is cheap
+                free = (gCachedOut - gRingIn - 1 + gRingBufSize) % gRingBufSize;
+        }
+        while (free == 0) {
+                WaitForOutChange(gCachedOut);
+                gCachedOut = GetOut();
+                free = (gCachedOut - gRingIn - 1 + gRingBufSize) % gRingBufSize;
+        }
+
+        int cnt = free < n ? free : n;
+        CopyIntoBuf(gRingIn, vals, cnt);
+        gRingIn = (gRingIn + cnt) % gRingBufSize;
+        SetIn(gRingIn);                                                         // Publish the whole batch at once
+        NotifyInChanged();
+        return cnt;
+}
+
+int ReadBatch(int* vals, int max)
+{
+        int avail = (gCachedIn - gRingOut + gRingBufSize) % gRingBufSize;
+
+        if (avail < max) {
+                gCachedIn = GetIn();                                            // Cached copy is short of a full batch, one reload per batch is cheap
+                avail = (gCachedIn - gRingOut + gRingBufSize) % gRingBufSize;
+        }
+        while (avail == 0) {
+                WaitForInChange(gCachedIn);
+                gCachedIn = GetIn();
+                avail = (gCachedIn - gRingOut + gRingBufSize) % gRingBufSize;
+        }
+
+        int cnt = avail < max ? avail : max;
+        CopyFromBuf(gRingOut, vals, cnt);
+        gRingOut = (gRingOut + cnt) % gRingBufSize;
+        SetOut(gRingOut);                                                       // Release the whole batch at once
+        NotifyOutChanged();
+        return cnt;
+}
+
+
+/***** MPMC RING *****/
+/*
+* Producers claim positions from enqueuePos and consumers from dequeuePos with a CAS, so any number of
+* each can work on the ring at once. The slot's sequence number says whether the claimed slot is ready;
+* if not, the claimer waits on that sequence word (spin, sleep or futex, as for SPSC).
+* Positions only grow: itemCnt and bufSize are both below 2^31, so a run never wraps the 32-bit counters.
+*/
+static MpmcSlot* MpmcSlotAt(unsigned int pos)
+{
+        return (MpmcSlot*) (gShmPtr + sizeof(ShmHeader)) + pos % gRingBufSize;
+}
+
+void InitMpmc()
+{
+        gRingBufSize = GetBufSize();
+        for (int i = 0; i < gRingBufSize; i++) {
+                atomic_init(&MpmcSlotAt(i)->seq, i);                            // Lap 0: slot i is free for position i
+        }
+        atomic_store(&SHM_HEADER->enqueuePos, 0);
+        atomic_store(&SHM_HEADER->dequeuePos, 0);
+        atomic_store(&SHM_HEADER->mpmcProdWaiting, 0);
+        atomic_store(&SHM_HEADER->mpmcConsWaiting, 0);
+        atomic_store(&SHM_HEADER->claimedItems, 0);
+}
+
+// Wait until the slot's sequence number moves on from seen
+static void MpmcWaitForSlot(MpmcSlot* slot, unsigned int seen, atomic_int* waiters, useconds_t sleepTime)
+{
+        switch (gShmOptions.waitMode) {
+        case WAIT_SPIN:
+                CpuRelax();
+                break;
+        case WAIT_SLEEP:
+                usleep(sleepTime);
+                break;
+        case WAIT_FUTEX:
+                atomic_fetch_add(waiters, 1);                                   // seq_cst, pairs with the fence in MpmcWake
+                if (atomic_load(&slot->seq) == seen) {
+                        FutexWait(&slot->seq, (int) seen);
+                }
+                atomic_fetch_sub(waiters, 1);
+                break;
+        }
+}
+
+// Several processes may be parked on the same slot (e.g. producers of two different laps), so wake them all
+static void MpmcWake(MpmcSlot* slot, atomic_int* waiters)
+{
+        if (gShmOptions.waitMode != WAIT_FUTEX) {
+                return;
+        }
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load_explicit(waiters, memory_order_relaxed) > 0) {
+                syscall(SYS_futex, (int*) &slot->seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+        }
+}
+
+unsigned int MpmcEnqueue(int value)
+{
+        unsigned int pos = atomic_load_explicit(&SHM_HEADER->enqueuePos, memory_order_relaxed);
+
+        while (true) {
+                MpmcSlot* slot = MpmcSlotAt(pos);
+                unsigned int seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+                int diff = (int) (seq - pos);
+
+                if (diff == 0) {
+                        // Slot is free for this lap, try to claim the position (pos is reloaded on failure)
+                        if (atomic_compare_exchange_weak_explicit(&SHM_HEADER->enqueuePos, &pos, pos + 1,
+                                                                  memory_order_relaxed, memory_order_relaxed)) {
+                                slot->value = value;
+                                atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+                                MpmcWake(slot, &SHM_HEADER->mpmcConsWaiting);
+                                return pos;
+                        }
+                } else if (diff < 0) {
+                        // The consumer of the previous lap has not emptied it yet: the ring is full
+                        MpmcWaitForSlot(slot, seq, &SHM_HEADER->mpmcProdWaiting, 100000);
+                        pos = atomic_load_explicit(&SHM_HEADER->enqueuePos, memory_order_relaxed);
+                } else {
+                        // Another producer took this position, move on
+                        pos = atomic_load_explicit(&SHM_HEADER->enqueuePos, memory_order_relaxed);
+                }
+        }
+}
+
+bool MpmcClaimItem()
+{
+        return atomic_fetch_add_explicit(&SHM_HEADER->claimedItems, 1, memory_order_relaxed) < GetItemCnt();
+}
+
+unsigned int MpmcDequeue(int* value)
+{
+        unsigned int pos = atomic_load_explicit(&SHM_HEADER->dequeuePos, memory_order_relaxed);
+
+        while (true) {
+                MpmcSlot* slot = MpmcSlotAt(pos);
+                unsigned int seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+                int diff = (int) (seq - (pos + 1));
+
+                if (diff == 0) {
+                        if (atomic_compare_exchange_weak_explicit(&SHM_HEADER->dequeuePos, &pos, pos + 1,
+                                                                  memory_order_relaxed, memory_order_relaxed)) {
+                                *value = slot->value;
+                                atomic_store_explicit(&slot->seq, pos + gRingBufSize, memory_order_release);
+                                MpmcWake(slot, &SHM_HEADER->mpmcProdWaiting);
+                                return pos;
+                        }
+                } else if (diff < 0) {
+                        // The producer of this position has not filled it yet: the ring is empty
+                        MpmcWaitForSlot(slot, seq, &SHM_HEADER->mpmcConsWaiting, 1000);
+                        pos = atomic_load_explicit(&SHM_HEADER->dequeuePos, memory_order_relaxed);
+                } else {
+                        pos = atomic_load_explicit(&SHM_HEADER->dequeuePos, memory_order_relaxed);
+                }
+        }
+}
+
+
+/***** BYTE RING *****/
+/*
+* Records are built and read directly inside the mapped buffer, there is no staging copy on either side.
+* "in"/"out" are byte offsets with the usual one-gap rule, so the same WaitFor*Change/Notify*Changed
+* wait strategies apply. A record never straddles the end of the buffer: if it does not fit, a RECORD_WRAP
+* header fills the tail and the record starts at offset 0. Records are limited to half the buffer so that
+* one of the two placements always becomes possible once the consumer catches up.
+*/
+static char* ByteAt(int offset)
+{
+        return (char*) gShmPtr + sizeof(ShmHeader) + offset;
+}
+
+static int RecordSpan(int len)
+{
+        int bytes = sizeof(RecordHeader) + len;
+        return (bytes + RECORD_ALIGN - 1) / RECORD_ALIGN * RECORD_ALIGN;
+}
+
+// Largest payload Reserve accepts for a byte ring of the given capacity
+int MaxRecordLen(int capacity)
+{
+        return capacity / 2 - sizeof(RecordHeader);
+}
+
+void* Reserve(int len)
+{
+        int span = RecordSpan(len);
+        int tail = gRingBufSize - gRingIn;                                      // Bytes left before the end of the buffer
+        int needed = span <= tail ? span : tail + span;                         // When it does not fit, the wrap marker eats the tail
+        int free = (gCachedOut - gRingIn - 1 + gRingBufSize) % gRingBufSize;
+
+        while (free < needed) {
+                gCachedOut = GetOut();
+                free = (gCachedOut - gRingIn - 1 + gRingBufSize) % gRingBufSize;
+                if (free < needed) {
+                        WaitForOutChange(gCachedOut);
+                }
+        }
+
+        int start = gRingIn;
+        if (span > tail) {
+                ((RecordHeader*) ByteAt(start))->len = RECORD_WRAP;             // Only becomes visible with Commit's release store
+                start = 0;
+        }
+        ((RecordHeader*) ByteAt(start))->len = len;
+        gReservedEnd = (start + span) % gRingBufSize;
+        return ByteAt(start) + sizeof(RecordHeader);
+}
+
+void Commit()
+{
+        gRingIn = gReservedEnd;
+        SetIn(gRingIn);
+        NotifyInChanged();
+}
+
+const void* Peek(int* len)
+{
+        while (gRingOut == gCachedIn && gRingOut == (gCachedIn = GetIn())) {    // Reload "in" only when the cached copy says empty
+                WaitForInChange(gCachedIn);
+        }
+
+        int start = gRingOut;
+        RecordHeader* hdr = (RecordHeader*) ByteAt(start);
+        if (hdr->len == RECORD_WRAP) {
+                start = 0;                                                      // The producer skipped the tail, the record is at the front
+                hdr = (RecordHeader*) ByteAt(0);
+        }
+        *len = hdr->len;
+        gPeekedEnd = (start + RecordSpan(hdr->len)) % gRingBufSize;
+        return ByteAt(start) + sizeof(RecordHeader);
+}
+
+void Release()
+{
+        gRingOut = gPeekedEnd;
+        SetOut(gRingOut);
+        NotifyOutChanged();
+}
+
+
+/***** WAITING AND WAKING *****/
+/*
+* The futex mode uses the "in"/"out" header words themselves as futex words (an atomic_int has the layout of an int).
+* A waiter raises its flag, re-checks the index and only then sleeps; the other side publishes the
+* index and only then checks the flag. The full fences between the two steps on each side make sure
+* at least one of them sees the other's write, so a wakeup can never be lost,
+* and a side that is never blocked pays no syscall per item.
+*/
+void WaitForOutChange(int seenOut)
+{
+        switch (gShmOptions.waitMode) {
+        case WAIT_SPIN:
+                CpuRelax();
+                break;
+        case WAIT_SLEEP:
+                usleep(100000);                                                 // Buffer is full, sleep for 100ms
+                break;
+        case WAIT_FUTEX:
+                atomic_store(&SHM_HEADER->prodWaiting, 1);                      // Announce that the producer is about to sleep
+                atomic_thread_fence(memory_order_seq_cst);
+                if (GetOut() == seenOut) {                                      // Re-check after announcing, the consumer may have just moved
+                        FutexWait(&SHM_HEADER->out, seenOut);
+                }
+                atomic_store(&SHM_HEADER->prodWaiting, 0);
+                break;
+        }
+}
+
+void WaitForInChange(int seenIn)
+{
+        switch (gShmOptions.waitMode) {
+        case WAIT_SPIN:
+                CpuRelax();
+                break;
+        case WAIT_SLEEP:
+                usleep(1000);                                                   // Buffer is empty, sleep for 1ms
+                break;
+        case WAIT_FUTEX:
+                atomic_store(&SHM_HEADER->consWaiting, 1);                      // Announce that the consumer is about to sleep
+                atomic_thread_fence(memory_order_seq_cst);
+                if (GetIn() == seenIn) {                                        // Re-check after announcing, the producer may have just moved
+                        FutexWait(&SHM_HEADER->in, seenIn);
+                }
+                atomic_store(&SHM_HEADER->consWaiting, 0);
+                break;
+        }
+}
+
+void NotifyInChanged()
+{
+        if (gShmOptions.waitMode != WAIT_FUTEX) {
+                return;                                                         // Polling modes notice the change on their own
+        }
+        atomic_thread_fence(memory_order_seq_cst);                              // Order the "in" store before reading the flag
+        if (atomic_load_explicit(&SHM_HEADER->consWaiting, memory_order_relaxed)) {
+                FutexWake(&SHM_HEADER->in);
+        }
+}
+
+void NotifyOutChanged()
+{
+        if (gShmOptions.waitMode != WAIT_FUTEX) {
+                return;                                                         // Polling modes notice the change on their own
+        }
+        atomic_thread_fence(memory_order_seq_cst);                              // Order the "out" store before reading the flag
+        if (atomic_load_explicit(&SHM_HEADER->prodWaiting, memory_order_relaxed)) {
+                FutexWake(&SHM_HEADER->out);
+        }
+}
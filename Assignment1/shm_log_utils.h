@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "shm_buffer.h"
+
+/*
+* Item logging
+* In the batched and binary modes the hot loop only appends to a large in-memory buffer.
+* When the buffer fills up it is handed to a background thread that does the write() while the
+* hot loop carries on in the second buffer, so formatting and I/O no longer sit between two handoffs.
+* Every mode keeps a count and a checksum of the values so the consumer can be checked against the producer.
+*/
+
+// Longest line LogItem can format: "Consuming Item " + 3 ints + fixed text
+#define LOG_MAX_LINE 96
+
+static const char* gLogRole;            // "Producer" / "Consumer"
+static const char* gLogVerb;            // "Producing" / "Consuming"
+static long long gLogCount;             // Items seen
+static unsigned long long gLogChecksum; // Order independent, so it also holds when items are spread over several consumers
+
+static char* gLogBufs[2];               // Double buffer
+static int gLogActive;                  // Buffer the hot loop is filling
+static size_t gLogUsed;                 // Bytes used in the active buffer
+static int gLogFd = -1;                 // Destination of the batched/binary output
+
+static pthread_t gLogThread;
+static pthread_mutex_t gLogLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gLogCond = PTHREAD_COND_INITIALIZER;
+static char* gLogPending;               // Buffer waiting to be written, NULL when the flusher is idle
+static size_t gLogPendingLen;
+static bool gLogStop;
+
+/***** CHECKSUM *****/
+// splitmix64 finalizer: sums of mixed values catch lost, duplicated and corrupted items
+static unsigned long long MixValue(unsigned long long x)
+{
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+}
+
+/***** BACKGROUND FLUSHER *****/
+static void WriteAll(int fd, const char* data, size_t len)
+{
+        while (len > 0) {
+                ssize_t n = write(fd, data, len);
+                if (n <= 0) {
+                        perror("Failure Point:write; Unable to write the item log...");
+                        return;
+                }
+                data += n;
+                len -= n;
+        }
+}
+
+static void* LogFlusher(void* arg)
+{
+        (void) arg;
+        pthread_mutex_lock(&gLogLock);
+        while (true) {
+                while (gLogPending == NULL && !gLogStop) {
+                        pthread_cond_wait(&gLogCond, &gLogLock);
+                }
+                if (gLogPending == NULL) {
+                        break;                                                  // Stopped and nothing left to write
+                }
+                char* data = gLogPending;
+                size_t len = gLogPendingLen;
+                pthread_mutex_unlock(&gLogLock);
+
+                WriteAll(gLogFd, data, len);                                    // The slow part, done without the lock
+
+                pthread_mutex_lock(&gLogLock);
+                gLogPending = NULL;
+                pthread_cond_broadcast(&gLogCond);                              // The hot loop may be waiting for this buffer
+        }
+        pthread_mutex_unlock(&gLogLock);
+        return NULL;
+}
+
+// Hand the active buffer to the flusher and continue in the other one
+static void LogSwapBuffers()
+{
+        pthread_mutex_lock(&gLogLock);
+        while (gLogPending != NULL) {
+                pthread_cond_wait(&gLogCond, &gLogLock);                        // Only blocks if the disk is slower than we produce log data
+        }
+        gLogPending = gLogBufs[gLogActive];
+        gLogPendingLen = gLogUsed;
+        pthread_cond_broadcast(&gLogCond);
+        pthread_mutex_unlock(&gLogLock);
+
+        gLogActive ^= 1;
+        gLogUsed = 0;
+}
+
+/***** FORMATTING *****/
+// Append the decimal form of val, much cheaper than going through printf's format parser
+static char* AppendInt(char* p, int val)
+{
+        char digits[12];
+        int len = 0;
+        unsigned int u = val < 0 ? 0u - (unsigned int) val : (unsigned int) val;
+
+        if (val < 0) {
+                *p++ = '-';
+        }
+        do {
+                digits[len++] = '0' + u % 10;
+                u /= 10;
+        } while (u != 0);
+        while (len > 0) {
+                *p++ = digits[--len];
+        }
+        return p;
+}
+
+static char* AppendStr(char* p, const char* str)
+{
+        size_t len = strlen(str);
+        memcpy(p, str, len);
+        return p + len;
+}
+
+/***** LOG API *****/
+void LogInit(const char* role, const char* verb)
+{
+        gLogRole = role;
+        gLogVerb = verb;
+        gLogCount = 0;
+        gLogChecksum = 0;
+
+        if (gShmOptions.logMode != LOG_BATCHED && gShmOptions.logMode != LOG_BINARY) {
+                return;
+        }
+
+        gLogFd = STDOUT_FILENO;
+        if (gShmOptions.logMode == LOG_BINARY || gShmOptions.logFile != NULL) {
+                // Each process gets its own file, two processes sharing one descriptor would interleave buffers
+                char path[4096];
+                const char* prefix = gShmOptions.logFile != NULL ? gShmOptions.logFile : "shm_log";
+                const char* ext = gShmOptions.logMode == LOG_BINARY ? "bin" : "txt";
+                snprintf(path, sizeof(path), "%s.%s.%s", prefix, role, ext);
+                gLogFd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+                if (gLogFd == -1) {
+                        perror("Failure Point:open; Unable to create the item log...");
+                        exit(1);
+                }
+        }
+
+        gLogBufs[0] = malloc(LOG_BUF_SIZE);
+        gLogBufs[1] = malloc(LOG_BUF_SIZE);
+        if (gLogBufs[0] == NULL || gLogBufs[1] == NULL) {
+                perror("Failure Point:malloc; Unable to allocate the log buffers...");
+                exit(1);
+        }
+        gLogActive = 0;
+        gLogUsed = 0;
+        gLogPending = NULL;
+        gLogStop = false;
+
+        fflush(stdout);                                                         // Keep earlier printf output ahead of our raw writes
+        if (pthread_create(&gLogThread, NULL, LogFlusher, NULL) != 0) {
+                fprintf(stderr, "Error: Unable to start the log flusher thread.\n");
+                exit(1);
+        }
+}
+
+void LogItem(int item, int value, int indx)
+{
+        gLogCount++;
+        gLogChecksum += MixValue((unsigned int) value);
+
+        switch (gShmOptions.logMode) {
+        case LOG_TEXT:
+                printf("%s Item %d with value %d at Index %d\n", gLogVerb, item, value, indx);
+                break;
+        case LOG_BATCHED: {
+                if (gLogUsed + LOG_MAX_LINE > LOG_BUF_SIZE) {
+                        LogSwapBuffers();                                       // Buffers only ever hold whole lines
+                }
+                char* p = gLogBufs[gLogActive] + gLogUsed;
+                char* start = p;
+                p = AppendStr(p, gLogVerb);
+                p = AppendStr(p, " Item ");
+                p = AppendInt(p, item);
+                p = AppendStr(p, " with value ");
+                p = AppendInt(p, value);
+                p = AppendStr(p, " at Index ");
+                p = AppendInt(p, indx);
+                *p++ = '\n';
+                gLogUsed += p - start;
+                break;
+        }
+        case LOG_BINARY: {
+                if (gLogUsed + sizeof(ItemRecord) > LOG_BUF_SIZE) {
+                        LogSwapBuffers();
+                }
+                ItemRecord rec = { item, value, indx };
+                memcpy(gLogBufs[gLogActive] + gLogUsed, &rec, sizeof(rec));
+                gLogUsed += sizeof(rec);
+                break;
+        }
+        case LOG_QUIET:
+                break;
+        }
+}
+
+void LogClose()
+{
+        if (gShmOptions.logMode == LOG_BATCHED || gShmOptions.logMode == LOG_BINARY) {
+                if (gLogUsed > 0) {
+                        LogSwapBuffers();
+                }
+                pthread_mutex_lock(&gLogLock);
+                gLogStop = true;
+                pthread_cond_broadcast(&gLogCond);
+                pthread_mutex_unlock(&gLogLock);
+                pthread_join(gLogThread, NULL);                                 // Writes out the last pending buffer first
+
+                if (gLogFd != STDOUT_FILENO) {
+                        close(gLogFd);
+                }
+                free(gLogBufs[0]);
+                free(gLogBufs[1]);
+        }
+
+        printf("%s summary: %lld items, checksum %016llx\n", gLogRole, gLogCount, gLogChecksum);
+}
+
+void LogAddToTotals(atomic_llong* cnt, atomic_ullong* sum)
+{
+        atomic_fetch_add(cnt, gLogCount);
+        atomic_fetch_add(sum, gLogChecksum);                                    // Wraps mod 2^64 like the per-process sums
+}
@@ -0,0 +1,318 @@
+/*
+CSC139
+Spring 2024
+First Assignment: shared memory ring benchmark
+Delgado, Eric
+Section #03
+OSs Tested on: Linux Only
+*/
+
+/*
+* Runs a fixed number of items through the same bounded buffer code the producer and consumer use,
+* for every combination of buffer size, wait strategy and batch size given on the command line.
+* Each item carries the (low 32 bits of the) CLOCK_MONOTONIC time at which it was written, so the
+* consumer can record the handoff latency of every item. The producer runs in the parent process,
+* the consumer in a forked child, and each can be pinned to a chosen CPU.
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "shm_buffer.h"
+#include "shm_buffer_utils.h"
+
+// Global pointer to the shared memory block
+void* gShmPtr;
+
+#define BENCH_SHM_NAME SHM_NAME "_bench"
+#define MAX_SWEEP 16
+
+// Results the consumer child hands back to the parent (anonymous shared mapping)
+typedef struct {
+    atomic_int ready;                   // Child is attached and pinned, the parent may start the clock
+    long long endNs;                    // When the child consumed the last item
+} BenchShared;
+
+// Function signatures
+long long NowNs();
+void PinToCpu(int);
+int ParseList(const char*, int*, int);
+int CompareUnsigned(const void*, const void*);
+void RunConsumer(int, int, int, unsigned int*, BenchShared*);
+void RunProducer(int, int);
+void RunCase(int, WaitMode, int, int, unsigned int*, BenchShared*);
+void PrintUsage(const char*);
+
+int gProducerCpu = -1;  // --cpus=P,C, -1 leaves placement to the scheduler
+int gConsumerCpu = -1;
+bool gCsv = false;
+
+int main(int argc, char* argv[])
+{
+        int items = 1000000;
+        int bufSizes[MAX_SWEEP] = { 64, 4096, 1 << 20 };
+        int bufCnt = 3;
+        int waits[MAX_SWEEP] = { WAIT_SPIN, WAIT_FUTEX };
+        int waitCnt = 2;
+        int batches[MAX_SWEEP] = { 1, 16, 256 };
+        int batchCnt = 3;
+
+        InitShmOptions(&gShmOptions);
+        for (int i = 1; i < argc; i++) {
+                if (strncmp(argv[i], "--items=", 8) == 0) {
+                        items = atoi(argv[i] + 8);
+                } else if (strncmp(argv[i], "--bufs=", 7) == 0) {
+                        bufCnt = ParseList(argv[i] + 7, bufSizes, MAX_SWEEP);
+                } else if (strncmp(argv[i], "--batches=", 10) == 0) {
+                        batchCnt = ParseList(argv[i] + 10, batches, MAX_SWEEP);
+                } else if (strncmp(argv[i], "--waits=", 8) == 0) {
+                        char list[256];
+                        snprintf(list, sizeof(list), "%s", argv[i] + 8);
+                        waitCnt = 0;
+                        for (char* tok = strtok(list, ","); tok != NULL && waitCnt < MAX_SWEEP; tok = strtok(NULL, ",")) {
+                                char opt[64];
+                                snprintf(opt, sizeof(opt), "--wait=%s", tok);
+                                if (ParseShmOption(opt, &gShmOptions) != 0) {
+                                        exit(1);
+                                }
+                                waits[waitCnt++] = gShmOptions.waitMode;
+                        }
+                } else if (strncmp(argv[i], "--cpus=", 7) == 0) {
+                        if (sscanf(argv[i] + 7, "%d,%d", &gProducerCpu, &gConsumerCpu) != 2) {
+                                fprintf(stderr, "Error: --cpus expects two CPU numbers, e.g. --cpus=0,1\n");
+                                exit(1);
+                        }
+                } else if (strcmp(argv[i], "--csv") == 0) {
+                        gCsv = true;
+                } else if (strcmp(argv[i], "--help") == 0) {
+                        PrintUsage(argv[0]);
+                        exit(0);
+                } else if (ParseShmOption(argv[i], &gShmOptions) != 0) {       // --hugetlb, --populate
+                        PrintUsage(argv[0]);
+                        exit(1);
+                }
+        }
+        if (items <= 0 || bufCnt <= 0 || waitCnt <= 0 || batchCnt <= 0) {
+                fprintf(stderr, "Error: Item count and every sweep list must be non-empty and positive.\n");
+                exit(1);
+        }
+
+        // One latency per item, written by the child, read by the parent after the child exits
+        unsigned int* latencies = mmap(NULL, items * sizeof(unsigned int), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        BenchShared* shared = mmap(NULL, sizeof(BenchShared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (latencies == MAP_FAILED || shared == MAP_FAILED) {
+                perror("Failure Point:mmap; Unable to map the result area...");
+                exit(1);
+        }
+
+        if (gCsv) {
+                printf("bufSize,wait,batch,items,items_per_s,bytes_per_s,p50_ns,p99_ns,p999_ns\n");
+        } else {
+                printf("Producer CPU %d, consumer CPU %d, %d items per case\n", gProducerCpu, gConsumerCpu, items);
+                printf("%10s %6s %6s %14s %12s %10s %10s %10s\n", "bufSize", "wait", "batch", "items/s", "MB/s", "p50 ns", "p99 ns", "p999 ns");
+        }
+        for (int b = 0; b < bufCnt; b++) {
+                for (int w = 0; w < waitCnt; w++) {
+                        for (int k = 0; k < batchCnt; k++) {
+                                RunCase(bufSizes[b], waits[w], batches[k], items, latencies, shared);
+                        }
+                }
+        }
+
+        return 0;
+}
+
+// Run one sweep point and print its line
+void RunCase(int bufSize, WaitMode waitMode, int batchSize, int items, unsigned int* latencies, BenchShared* shared)
+{
+        size_t pageSize;
+
+        if (bufSize < 2 || bufSize > MAX_BUF_SIZE || batchSize < 1 || batchSize > MAX_BATCH_SIZE) {
+                fprintf(stderr, "Skipping bufSize=%d batch=%d: out of range\n", bufSize, batchSize);
+                return;
+        }
+        gShmOptions.waitMode = waitMode;
+        gShmOptions.batchSize = batchSize;
+
+        // Same segment setup as the producer
+        int fd = OpenShmSegment(BENCH_SHM_NAME, O_RDWR | O_CREAT, &pageSize);
+        size_t shmSize = ShmSegmentSize(bufSize, pageSize);
+        if (fd == -1 || ftruncate(fd, shmSize) == -1) {
+                perror("Failure Point:shm_open/ftruncate; Unable to create the benchmark segment...");
+                exit(1);
+        }
+        gShmPtr = MapShmSegment(fd, shmSize);
+        if (gShmPtr == MAP_FAILED) {
+                perror("Failure Point:mmap; Unable to map the benchmark segment...");
+                UnlinkShmSegment(BENCH_SHM_NAME);
+                exit(1);
+        }
+        close(fd);
+        InitShmHeader(bufSize, items);
+        atomic_store(&shared->ready, 0);
+
+        fflush(stdout);                                                         // Or the child repeats our buffered output at exit
+        pid_t pid = fork();
+        if (pid < 0) {
+                fprintf(stderr, "Fork Failed\n");
+                exit(1);
+        }
+        if (pid == 0) {
+                RunConsumer(bufSize, items, batchSize, latencies, shared);
+                exit(0);
+        }
+
+        PinToCpu(gProducerCpu);
+        while (!atomic_load(&shared->ready)) {
+                sched_yield();                                                  // Don't count fork and page-in of the child
+        }
+
+        long long startNs = NowNs();
+        RunProducer(bufSize, items);
+        waitpid(pid, NULL, 0);
+        double seconds = (shared->endNs - startNs) / 1e9;
+
+        munmap(gShmPtr, shmSize);
+        UnlinkShmSegment(BENCH_SHM_NAME);
+
+        qsort(latencies, items, sizeof(unsigned int), CompareUnsigned);
+        unsigned int p50 = latencies[(long long) items * 50 / 100];
+        unsigned int p99 = latencies[(long long) items * 99 / 100];
+        unsigned int p999 = latencies[(long long) items * 999 / 1000];
+        double itemsPerSec = items / seconds;
+        double bytesPerSec = itemsPerSec * sizeof(int);
+
+        if (gCsv) {
+                printf("%d,%s,%d,%d,%.0f,%.0f,%u,%u,%u\n", bufSize, WaitModeName(waitMode), batchSize, items, itemsPerSec, bytesPerSec, p50, p99, p999);
+        } else {
+                printf("%10d %6s %6d %14.0f %12.1f %10u %10u %10u\n", bufSize, WaitModeName(waitMode), batchSize, itemsPerSec, bytesPerSec / 1e6, p50, p99, p999);
+        }
+        fflush(stdout);
+}
+
+// The producer side: every item is the time it was handed over
+void RunProducer(int bufSize, int items)
+{
+        int batchSize = gShmOptions.batchSize;
+        int batch[batchSize];
+        int in = 0;
+
+        AttachRing();
+        for (int i = 0; i < items; ) {
+                if (batchSize > 1) {
+                        int cnt = items - i < batchSize ? items - i : batchSize;
+                        for (int done = 0; done < cnt; ) {
+                                WaitForSpace(gRingIn);                          // Stamp once there is room, like the per-item path, so
+                                unsigned int stamp = (unsigned int) NowNs();    // the latency leaves out the producer's own wait
+                                for (int k = done; k < cnt; k++) {
+                                        batch[k] = (int) stamp;
+                                }
+                                done += WriteBatch(batch + done, cnt - done);
+                        }
+                        i += cnt;
+                } else {
+                        WaitForSpace(in);
+                        WriteAtBufIndex(in, (int) (unsigned int) NowNs());
+                        in = (in + 1) % bufSize;
+                        SetIn(in);
+                        NotifyInChanged();
+                        i++;
+                }
+        }
+}
+
+// The consumer side: latency = now - stamp, modulo 2^32 ns (fine for anything below ~4 s)
+void RunConsumer(int bufSize, int items, int batchSize, unsigned int* latencies, BenchShared* shared)
+{
+        int batch[batchSize];
+        int out = 0;
+
+        PinToCpu(gConsumerCpu);
+        AttachRing();
+        for (int i = 0; i < items; i += 4096) {
+                latencies[i] = 0;                                               // Fault the result pages in before the clock starts
+        }
+        atomic_store(&shared->ready, 1);
+
+        for (int consumed = 0; consumed < items; ) {
+                if (batchSize > 1) {
+                        int want = items - consumed < batchSize ? items - consumed : batchSize;
+                        int cnt = ReadBatch(batch, want);
+                        unsigned int now = (unsigned int) NowNs();
+                        for (int k = 0; k < cnt; k++) {
+                                latencies[consumed++] = now - (unsigned int) batch[k];
+                        }
+                } else {
+                        WaitForItem(out);
+                        unsigned int stamp = (unsigned int) ReadAtBufIndex(out);
+                        out = (out + 1) % bufSize;
+                        SetOut(out);
+                        NotifyOutChanged();
+                        latencies[consumed++] = (unsigned int) NowNs() - stamp;
+                }
+        }
+        shared->endNs = NowNs();
+}
+
+long long NowNs()
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void PinToCpu(int cpu)
+{
+        if (cpu < 0) {
+                return;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) == -1) {
+                perror("Warning: sched_setaffinity; running unpinned");
+        }
+}
+
+// Parse "a,b,c" into vals, returns the count
+int ParseList(const char* str, int* vals, int max)
+{
+        int cnt = 0;
+        const char* p = str;
+        while (*p != '\0' && cnt < max) {
+                vals[cnt++] = atoi(p);
+                p = strchr(p, ',');
+                if (p == NULL) {
+                        break;
+                }
+                p++;
+        }
+        return cnt;
+}
+
+int CompareUnsigned(const void* a, const void* b)
+{
+        unsigned int x = *(const unsigned int*) a;
+        unsigned int y = *(const unsigned int*) b;
+        return (x > y) - (x < y);
+}
+
+void PrintUsage(const char* prog)
+{
+        fprintf(stderr, "Usage: %s [options]\n", prog);
+        fprintf(stderr, "  --items=N                 Items per case (default 1000000)\n");
+        fprintf(stderr, "  --bufs=a,b,...            Buffer sizes to sweep (default 64,4096,1048576)\n");
+        fprintf(stderr, "  --waits=spin,sleep,futex  Wait strategies to sweep (default spin,futex)\n");
+        fprintf(stderr, "  --batches=a,b,...         Batch sizes to sweep (default 1,16,256)\n");
+        fprintf(stderr, "  --cpus=P,C                Pin producer to CPU P and consumer to CPU C\n");
+        fprintf(stderr, "  --hugetlb[=dir] --populate  Segment backing, as for producer\n");
+        fprintf(stderr, "  --csv                     Machine readable output\n");
+}
@@ -14,20 +14,59 @@ OSs Tested on: Linux Only
 #include <limits.h>
 #include "scheduler.h"
 #include "scheduler_utils.h"
+#include "scheduler_engine_utils.h"
+#include "scheduler_loader_utils.h"
+#include "scheduler_compare_utils.h"
+#include "scheduler_sweep_utils.h"
+#include "scheduler_stream_utils.h"
+#include "scheduler_bench_utils.h"
 
 
 
 /****** MAIN ******/
-int main() {
-    Process procs[MAX_PROCESSES];
+int main(int argc, char *argv[]) {
+    Process *procs = NULL;                                                                  // Allocated by initialize_scheduling once the process count is known
     int n, quantum;
     char scheduling_algo[25];
+    TraceGenConfig gen = TRACE_GEN_DEFAULTS;                                                // Workload shape for --bench
+
+    for (int i = 1; i < argc; i++) {
+        int rc = trace_gen_parse_option(argv[i], &gen);
+        if (rc == -1 || (rc == 1 && parse_sched_option(argv[i], &gSchedOptions) != 0)) {
+            fprintf(stderr, "Usage: %s [--layout=aos|soa] [--write-binary=out.schb] [--compare [--quanta=a,b,...] [--threads=N]]\n"
+                            "       [--sweep=dir|manifest [--algos=RR,SJF,...|all] [--quanta=a,b,...] [--format=csv|json] [--output=file] [--threads=N]]\n"
+                            "       [--stream[=file|fifo|tcp:host:port] [--window=N]]\n"
+                            "       [--bench[=max] [trace_gen options, see trace_gen.c]] [trace]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
 
-    if (initialize_scheduling("input", procs, &n, scheduling_algo, &quantum) != 0) {
+    if (gSchedOptions.bench_max > 0) {
+        return bench_schedules(&gen, gSchedOptions.bench_max);                              // Generated traces only, nothing is loaded
+    }
+    if (gSchedOptions.stream != NULL) {
+        return stream_schedules(gSchedOptions.stream);                                      // Online: arrivals are scheduled as they are read
+    }
+    if (gSchedOptions.sweep != NULL) {
+        return sweep_schedules(gSchedOptions.sweep);                                        // Loads its own traces, no input probing
+    }
+
+    if (initialize_scheduling("input", &procs, &n, scheduling_algo, &quantum) != 0) {
         return EXIT_FAILURE;
     }
 
-    execute_schedule(scheduling_algo, procs, n, quantum);
+    if (gSchedOptions.write_binary != NULL) {                                               // Conversion only, nothing is scheduled
+        int rc = write_binary_trace(gSchedOptions.write_binary, procs, n, scheduling_algo, quantum);
+        free(procs);
+        return rc == 0 ? 0 : EXIT_FAILURE;
+    }
+
+    if (gSchedOptions.compare) {
+        compare_schedules(procs, n, strcmp(scheduling_algo, "RR") == 0 ? quantum : 0);        // Every algorithm on the same trace, one table
+    } else {
+        execute_schedule(scheduling_algo, procs, n, quantum);
+    }
+    free(procs);
 
     return 0;  // Return 0 to indicate successful execution
 }
@@ -40,181 +79,174 @@ int main() {
 
 /****** ROUND ROBIN ******/
 void round_robin(Process procs[], int n, int quantum) {
-    int current_time = 0;                                                                   // Initialize current time to 0 for the start of scheduling
-    int exec_time;                                                                          // Declare a variable to hold the execution time of a process during a quantum slice
-    int completed = 0;                                                                      // Counter for the number of processes that have completed execution
-    Queue queue;                                                                            // Declare a queue to manage the processes ready for execution
-    queue.count = 0;                                                                        // Initialize the process count in the queue to 0
+    SimEngine eng;                                                                          // Event engine: arrival cursor and simulation clock
 
+    engine_init(&eng, procs, n);
+    round_robin_events(&eng, quantum);
+    engine_free(&eng);
+}
 
-    while (completed < n) {
-        for (int i = 0; i < n; i++) {
-            if (procs[i].arrival_time <= current_time && !procs[i].has_started) {           // Check if process has arrived AND not started
-                queue.processes[queue.count++] = &procs[i];                                 // Enqueue the process
-                procs[i].has_started = 1;                                                   // Mark as started
-            }
+void round_robin_events(SimEngine *eng, int quantum) {
+    Queue queue;                                                                            // Declare a queue to manage the processes ready for execution
+    Process *arrived;
+
+    queue_init(&queue, eng->n);
+    while (!engine_done(eng)) {
+        while ((arrived = engine_pop_arrival(eng)) != NULL) {                              // Enqueue everything that has arrived by now, in arrival order
+            queue_push_back(&queue, arrived);
         }
 
-        if (queue.count == 0) {                                                             // Check If Queue Is Empty
-            current_time++;                                                                 // Increment the current time
+        Process *proc_ptr = queue_pop_front(&queue);                                        // Create pointer for curent process & get the first process in the queue, O(1)
+        if (proc_ptr == NULL) {                                                             // Check If Queue Is Empty
+            engine_idle(eng);                                                               // Jump straight to the next arrival
             continue;                                                                       // Skip to the next iteration of the loop
         }
 
-        Process *proc_ptr = queue.processes[0];                                             // Create pointer for curent process & get the first process in the queue
-        for (int i = 0; i < queue.count - 1; i++) {                                         // Loop to shift all processes in the queue up by one position
-            queue.processes[i] = queue.processes[i + 1];                                    // Move each process one position forward in the queue
+        if (!engine_run(eng, proc_ptr, quantum)) {                                          // Run one quantum (or less if the process finishes first)
+            queue_push_back(&queue, proc_ptr);                                              // Reinsert the process into the queue if it has time left
         }
-        queue.count--;                                                                      // Decrease count as the first process is taken out for execution
+    }
+    queue_free(&queue);
+}
 
-        if (proc_ptr->remaining_time < quantum) {                                           // If remaining time is less than the quantum
-            exec_time = proc_ptr->remaining_time;                                           // Assign remaining time to exec_time
-        } else {
-            exec_time = quantum;                                                            // Else assign quantum to exec_time if remaining time is more
-        }
-        proc_ptr->remaining_time -= exec_time;                                              // Subtract the execution time from the process's remaining time
-        current_time += exec_time;                                                          // Increment the current time by the execution time
-
-        
-        if (proc_ptr->remaining_time > 0) {                                                 // Check if there is still execution time left for the process
-            queue.processes[queue.count++] = proc_ptr;                                      // Reinsert the process into the queue if it has time left
-        } else {
-            completed++;                                                                    // Increment count of completed processes
-            proc_ptr->finish_time = current_time;                                           // Set finish time for the process
-            calculate_waiting_time(proc_ptr, current_time);                                 // Calculate waiting time
-        }
 
-    }
 
-    print_process_time_results(procs, n);                                                   // Call to print results
-    calculate_waiting_average(procs, n);                                                    // Calculate and print the average waiting time
+/****** NON-PREEMPTIVE SELECTION ******/
+bool shorter_burst(const Process *a, const Process *b) {
+    return a->cpu_burst_time < b->cpu_burst_time;
 }
 
+bool higher_priority(const Process *a, const Process *b) {
+    return a->priority < b->priority;                                                       // Lower number means higher priority
+}
 
+// Whenever the CPU is free, run the ready process better() prefers to completion
+void run_nonpreemptive(Process procs[], int n, bool (*better)(const Process *, const Process *)) {
+    SimEngine eng;
 
-/****** SHORTEST JOB FIRST ******/
-void sjf(Process procs[], int n) {
-    int current_time = 0;                                                                   // Initialize current time to 0
-    bool completed[n];                                                                      // Create an array to track completion status of each process
-    for (int i = 0; i < n; i++) {
-        completed[i] = false;                                                               // Initialize all process completion statuses to false
-    }
-    int processes_completed = 0;                                                            // Counter for the number of processes that have completed
-
-    while (processes_completed < n) {                                                       // Continue looping until all processes are completed
-        int shortest_time = INT_MAX;                                                        // Initialize shortest_time with the maximum possible value
-        int idx = -1;                                                                       // Initialize idx as -1, to store the index of the process with the shortest burst time
-        for (int i = 0; i < n; i++) {                                                       // Iterate over all processes to find the one with the shortest CPU burst time
-            if (!completed[i] && procs[i].arrival_time <= current_time && procs[i].cpu_burst_time < shortest_time) {    // If process i is not completed, has arrived, and has a burst time shorter than the current shortest
-                shortest_time = procs[i].cpu_burst_time;                                    // Update shortest_time with the smallest burst time found
-                idx = i;                                                                    // Update idx with the index of the process
-            }
+    engine_init(&eng, procs, n);
+    nonpreemptive_events(&eng, better);
+    engine_free(&eng);
+}
+
+void nonpreemptive_events(SimEngine *eng, bool (*better)(const Process *, const Process *)) {
+    ProcessHeap ready;                                                                      // Processes that have arrived and are not complete
+    Process *arrived;
+
+    heap_init(&ready, eng->n, better);
+    while (!engine_done(eng)) {                                                             // Continue looping until all processes are completed
+        while ((arrived = engine_pop_arrival(eng)) != NULL) {
+            heap_push(&ready, arrived);                                                     // Each process enters the heap once, O(log n)
         }
-        if (idx == -1) {                                                                    // If no process is ready to execute
-            current_time++;                                                                 // Increment current time by 1 unit
-        } else {                                                                            // If a process is ready to execute
-            current_time += procs[idx].cpu_burst_time;                                      // Update current_time by adding the burst time of the selected process
-            procs[idx].finish_time = current_time;                                          // Set the finish time for the process
-            calculate_waiting_time(&procs[idx], current_time);                              // Calculate waiting time
-            completed[idx] = true;                                                          // Mark this process as completed
-            processes_completed++;                                                          // Increment the count of completed processes
+        Process *proc = heap_pop(&ready);
+        if (proc == NULL) {                                                                 // If no process is ready to execute
+            engine_idle(eng);                                                               // Jump to the next arrival instead of ticking
+            continue;
         }
+        engine_run(eng, proc, proc->remaining_time);                                        // Runs to completion, sets finish and waiting time
     }
-
-    print_process_time_results(procs, n);                                                   // Call to print the process time results
-    calculate_waiting_average(procs, n);                                                    // Calculate and print the average waiting time for all processes
+    heap_free(&ready);
 }
 
 
 
-/****** PRIORITY SCHEDULING WITHOUT PREEMPTION ******/
-void pr_noPREMP(Process procs[], int n) {
-    int current_time = 0;                                                                   // Initialize current time to 0 for the start of scheduling
-    bool completed[n];                                                                      // Array to track completion status of each process
-    for (int i = 0; i < n; i++) {
-        completed[i] = false;                                                               // Initialize all processes as not completed
+// The same schedule on the structure-of-arrays table: the ready set is every arrived entry whose key is not SIM_TIME_NEVER
+void run_nonpreemptive_soa(Process procs[], int n, SelectKey key) {
+    ProcessTable table;
+    sim_time_t now = 0;
+    int arrived = 0;                                                                        // Entries [0, arrived) have arrival_time <= now
+    int first = 0;                                                                          // Entries before this one have all completed
+    int completed = 0;
+
+    table_init(&table, procs, n, key);
+    while (completed < n) {
+        while (arrived < n && table.arrival_time[arrived] <= now) {
+            arrived++;
+        }
+        while (first < arrived && table.key[first] == SIM_TIME_NEVER) {
+            first++;                                                                        // Keep the scan window to the part that can still be picked
+        }
+        int pick = table_select_min(&table, first, arrived);
+        if (pick < 0) {
+            now = table.arrival_time[arrived];                                              // Nothing ready, jump to the next arrival
+            continue;
+        }
+        now += table.cpu_burst_time[pick];                                                  // Runs to completion
+        table.finish_time[pick] = now;
+        table.key[pick] = SIM_TIME_NEVER;
+        completed++;
     }
-    int processes_completed = 0;                                                            // Counter for the number of processes that have completed execution
+    table_store_results(&table, procs);
+    table_free(&table);
+}
 
-    while (processes_completed < n) {                                                       // Continue scheduling until all processes are completed
-        int highest_priority = INT_MAX;                                                     // Start with the highest possible priority (lower number means higher priority)
-        int idx = -1;                                                                       // Index of the currently selected process for execution
 
-        for (int i = 0; i < n; i++) {                                                       // For all process find the process with the highest priority that has arrived
-            if (!completed[i] && procs[i].arrival_time <= current_time && procs[i].priority < highest_priority) { // If process i is not completed, has arrived, and has a burst time shorter than the current shortest
-                highest_priority = procs[i].priority;                                       // Update the highest priority found
-                idx = i;                                                                    // Update the index of the process with the highest priority
-            }
-        }
 
-        if (idx == -1) {                                                                    // If no process is ready to run, increment the current time
-            current_time++;
-        } else {                                                                            // If a process is found
-            current_time += procs[idx].cpu_burst_time;                                      // Increase current time by the burst time of the selected process
-            procs[idx].finish_time = current_time;                                          // Set finish time for the process
-            calculate_waiting_time(&procs[idx], current_time);                              // Calculate waiting time
-            completed[idx] = true;                                                          // Mark the process as completed
-            processes_completed++;                                                          // Increment the count of completed processes
-        }
+/****** SHORTEST JOB FIRST ******/
+void sjf(Process procs[], int n) {
+    if (gSchedOptions.layout == LAYOUT_SOA) {
+        run_nonpreemptive_soa(procs, n, KEY_BURST);
+    } else {
+        run_nonpreemptive(procs, n, shorter_burst);                                         // Pick the shortest CPU burst each time the CPU frees up
     }
+}
+
 
-    print_process_time_results(procs, n);                                                   // Print results for each process
-    calculate_waiting_average(procs, n);                                                    // Calculate and print the average waiting time of all processes
+
+/****** PRIORITY SCHEDULING WITHOUT PREEMPTION ******/
+void pr_noPREMP(Process procs[], int n) {
+    if (gSchedOptions.layout == LAYOUT_SOA) {
+        run_nonpreemptive_soa(procs, n, KEY_PRIORITY);
+    } else {
+        run_nonpreemptive(procs, n, higher_priority);                                       // Pick the highest priority each time the CPU frees up
+    }
 }
 
 
 
 /****** PRIORITY SCHEDULING WITH PREEMPTION ******/
+/*
+* The running process keeps the CPU until it completes or a process with a strictly higher priority arrives.
+* Between two events the engine runs it in one step: up to its completion or the next arrival, whichever is first,
+* so preemption is only looked at on those events and each one costs O(log n) in the ready heap.
+* A preempted process goes back to the ready set with its remaining time and competes again by priority.
+*/
 void PR_PREMP(Process procs[], int n) {
-    int current_time = 0;                                                                   // Initialize current simulation time
-    int current_process_idx = -1;                                                           // Index for tracking the currently executing process
-    int current_process_end_time = INT_MAX;                                                 // End time for the currently executing process
-    bool completed[n];                                                                      // Initialize an array to keep track of completion status of processes
-
-    for (int i = 0; i < n; i++) {
-        completed[i] = false;                                                               // Initialize all processes as not completed
-        procs[i].has_started = false;                                                       // Mark all processes as not started
-    }
+    SimEngine eng;
 
-    while (true) {                                                                          // While all process aren't done, check for new arrivals and possible preemption
-        bool found_higher_priority = false;                                                 // Flag to check if a higher priority process is found
-        for (int i = 0; i < n; i++) {
-            if (procs[i].arrival_time <= current_time && !procs[i].has_started && !completed[i]) {            // If the process is ready to run and has not been completed or started
-                if (current_process_idx == -1 || (procs[i].priority < procs[current_process_idx].priority && procs[i].remaining_time > 0)) {    // If no current process or a higher priority process is found
-                    if (current_process_idx != -1 && current_time < current_process_end_time) {               // Preempt the current process if a higher priority process is found
-                        procs[current_process_idx].remaining_time = current_process_end_time - current_time;  // Save the remaining time for the preempted process
-                    }
-                    current_process_idx = i;                                                // Update the current process index
-                    current_process_end_time = current_time + procs[i].cpu_burst_time;      // Set the end time for the current process
-                    procs[i].has_started = true;                                            // Mark the process as started
-                    found_higher_priority = true;                                           // Set the flag for higher priority found
-                }
-            }
-        }
+    engine_init(&eng, procs, n);
+    preemptive_priority_events(&eng);
+    engine_free(&eng);
+}
 
-        if (current_process_idx != -1 && !found_higher_priority) {                          // If no higher priority process was found, execute the current process 
-            if (current_time >= current_process_end_time) {                                 // Check if the current time has reached the process end time
-                procs[current_process_idx].finish_time = current_time;                      // Set the finish time for the process
-                calculate_waiting_time(&procs[current_process_idx], current_time);          // Calculate waiting time
-                completed[current_process_idx] = true;                                      // Mark the process as completed
-                current_process_idx = -1;                                                   // Reset the current process index
-            }
+void preemptive_priority_events(SimEngine *eng) {
+    ProcessHeap ready;                                                                      // Arrived, not running, not complete
+    Process *current = NULL;                                                                // Process on the CPU, NULL when idle
+    Process *arrived;
+
+    heap_init(&ready, eng->n, higher_priority);
+    while (!engine_done(eng)) {                                                             // Each pass is one event: an arrival, a completion, or both
+        bool arrivals = false;
+        while ((arrived = engine_pop_arrival(eng)) != NULL) {
+            heap_push(&ready, arrived);
+            arrivals = true;
         }
 
-        // Check if all processes are completed
-        bool all_done = true;
-        for (int i = 0; i < n; i++) {
-            if (!completed[i]) {
-                all_done = false;                                                           // If any process is not completed, continue the loop
-                break;
-            }
+        if (current == NULL) {
+            current = heap_pop(&ready);                                                     // Completion (or idle CPU): dispatch the best ready process
+        } else if (arrivals && higher_priority(heap_peek(&ready), current)) {
+            current = heap_replace_top(&ready, current);                                    // Preempt: the current process keeps its remaining time
         }
-        if (all_done) {                                                                     // if all procces are done
-            break;                                                                          // Exit the loop 
+        if (current == NULL) {
+            engine_idle(eng);                                                               // Nothing ready, jump to the next arrival
+            continue;
         }
 
-        current_time++;                                                                     // Increment the simulation time
+        sim_time_t next_arrival = engine_next_arrival_time(eng);
+        sim_time_t slice = next_arrival == SIM_TIME_NEVER ? current->remaining_time : next_arrival - eng->now;
+        if (engine_run(eng, current, slice)) {                                              // Run until it completes or the next arrival may preempt it
+            current = NULL;
+        }
     }
-
-    print_process_time_results(procs, n);                                                   // Call to print results
-    calculate_waiting_average(procs, n);                                                    // Calculate and print the average waiting time
+    heap_free(&ready);
 }
@@ -2,8 +2,11 @@
 #define SCHEDULER_H
 
 #include <stdbool.h> // Needed for the 'bool' type
+#include <limits.h>  // LLONG_MAX
+#include <stdint.h>  // Fixed-width fields of the binary trace
 
-#define MAX_PROCESSES 100
+// Simulated time, 64-bit so traces can span billions of ticks
+typedef long long sim_time_t;
 
 
 /*
@@ -14,40 +17,283 @@ typedef struct {
     bool has_started;           // Boolean flag to indicate if the process has started execution
     int process_number;         // Unique identifier
     int priority;               // Priority for scheduling
-    int start_time;             // Time when the process starts its execution
-    int finish_time;            // Time when the process finishes its execution
-    int arrival_time;           // Time when the process arrives
-    int waiting_time;           // Total time the process has been in the ready queue
-    int response_time;          // Time from arrival until the first time the process is scheduled on the CPU
-    int remaining_time;         // Time remaining for the process to complete execution
-    int cpu_burst_time;         // Time the process requires CPU
-    int last_execution_time;    // The last time when the process was executed on the CPU (for response time in pre-emptive algorithms)
+    sim_time_t start_time;      // Time when the process starts its execution
+    sim_time_t finish_time;     // Time when the process finishes its execution
+    sim_time_t arrival_time;    // Time when the process arrives
+    sim_time_t waiting_time;    // Total time the process has been in the ready queue
+    sim_time_t response_time;   // Time from arrival until the first time the process is scheduled on the CPU
+    sim_time_t remaining_time;  // Time remaining for the process to complete execution
+    sim_time_t cpu_burst_time;  // Time the process requires CPU
+    sim_time_t last_execution_time; // The last time when the process was executed on the CPU (for response time in pre-emptive algorithms)
 } Process;
 
 
 /*
-* The `Queue` structure holds an array of pointers to `Process` structures, 
-* enabling the queue operations required for process management.
+* The `Queue` structure is a growable ring-buffer deque of pointers to `Process` structures,
+* so enqueueing and dequeueing are O(1) however many processes are waiting.
 */
 typedef struct {
-    Process *processes[MAX_PROCESSES];  // Array holding pointers to 'Process' instances, with 'MAX_PROCESSES' as its capacity.
-    int count;                          // Counts the number of 'Process' pointers currently in the queue.
+    Process **processes;        // Ring storage, capacity is a power of two so indices wrap with a mask
+    int head;                   // Slot of the front element
+    int count;                  // Counts the number of 'Process' pointers currently in the queue.
+    int capacity;               // Allocated slots, doubled when the ring is full
 } Queue;
 
 
+/*
+* Discrete-event simulation engine shared by all algorithms (scheduler_engine_utils.h)
+* Processes are sorted by arrival time once. The engine hands arrivals out in that order and jumps the clock
+* straight to the next arrival or completion, so a run costs per event instead of per simulated tick.
+* With a stream attached (--stream) the arrivals come from it instead of by_arrival, and completed processes go back to it.
+*/
+typedef struct ArrivalStream ArrivalStream;
+
+typedef struct {
+    Process **by_arrival;       // All processes ordered by arrival_time, ties in input order
+    int n;                      // Number of processes
+    int next_arrival;           // Cursor into by_arrival: first process that has not arrived yet
+    int completed;              // Processes that have finished
+    sim_time_t now;             // Current simulation time
+    ArrivalStream *stream;      // Live arrival source, NULL when by_arrival holds the whole trace
+    long long events;           // Arrivals admitted plus CPU slices run, reported by --bench
+} SimEngine;
+
+#define SIM_TIME_NEVER LLONG_MAX
+
+
+/*
+* Binary min-heap of ready processes for SJF and the priority algorithms
+* better() orders by burst or priority, equal keys fall back to process_number so every run picks the same process.
+*/
+typedef struct {
+    Process **items;            // Heap-ordered array, items[0] is the next process to run
+    int count;                  // Processes currently in the heap
+    int capacity;               // Allocated slots, grows on demand
+    bool (*better)(const Process *, const Process *);
+} ProcessHeap;
+
+
+/*
+* Structure-of-arrays copy of the processes for the scan kernels (--layout=soa)
+* Entries are in arrival order. A selection loop only streams the one key array it compares, which the compiler vectorizes.
+*/
+typedef struct {
+    int n;
+    int *index;                 // Position of the entry in procs[], for copying results back
+    int *process_number;
+    sim_time_t *arrival_time;
+    sim_time_t *cpu_burst_time;
+    sim_time_t *finish_time;
+    sim_time_t *key;            // Selection key (burst or priority), SIM_TIME_NEVER once the entry has completed
+} ProcessTable;
+
+// Which field the non-preemptive scan kernel selects on
+typedef enum {
+    KEY_BURST,
+    KEY_PRIORITY
+} SelectKey;
+
+// Memory layout the non-preemptive algorithms run on
+typedef enum {
+    LAYOUT_AOS,                 // Process structs with the ready heap (default)
+    LAYOUT_SOA                  // ProcessTable with a vectorizable minimum scan over the arrived entries
+} ProcessLayout;
+
+// Machine-readable output of --sweep
+typedef enum {
+    FORMAT_CSV,                 // One header line, one row per scenario (default)
+    FORMAT_JSON                 // One array of objects
+} ResultFormat;
+
+
+/*
+* Binary trace format (scheduler_loader_utils.h), native byte order
+* A TraceBinaryHeader followed by count TraceBinaryRecords. --write-binary converts a text trace to it.
+*/
+#define TRACE_BINARY_MAGIC "SCHB"
+#define TRACE_BINARY_VERSION 1
+#define TRACE_ALGO_LEN 24       // Room for the algorithm name including its terminator
+
+typedef struct {
+    char magic[4];              // TRACE_BINARY_MAGIC, no terminator
+    uint32_t version;           // TRACE_BINARY_VERSION
+    char algo[TRACE_ALGO_LEN];  // Scheduling algorithm, NUL padded
+    int32_t quantum;            // RR quantum, unused otherwise
+    uint32_t reserved;
+    uint64_t count;             // Number of records that follow
+} TraceBinaryHeader;
+
+typedef struct {
+    int32_t process_number;
+    int32_t priority;
+    int64_t arrival_time;
+    int64_t cpu_burst_time;
+} TraceBinaryRecord;
+
+
+/*
+* One run of --compare or --sweep: an algorithm on its own copy of a trace, and the averages it produced
+*/
+typedef struct {
+    const char *trace;          // Trace the job came from (--sweep), NULL for --compare
+    const char *algo;           // Name as accepted by run_algorithm()
+    int quantum;                // RR only
+    const Process *source;      // Loaded trace, shared read-only between jobs
+    int n;                      // Processes in source
+    Process *procs;             // Private copy while the job runs, the runs share nothing mutable
+    int status;                 // 0 when the run succeeded, -1 for an unknown algorithm
+    double avg_waiting;
+    double avg_turnaround;      // finish - arrival
+    double avg_response;        // first dispatch - arrival
+    sim_time_t makespan;        // Finish time of the last process
+} CompareJob;
+
+#define MAX_COMPARE_QUANTA 16
+#define DEFAULT_COMPARE_QUANTUM 4
+
+
+/*
+* Running statistic of one per-process time in --stream: the mean over everything completed so far
+* and the mean over the last window_size completions
+*/
+typedef struct {
+    long long count;
+    double sum;
+    sim_time_t max;
+    sim_time_t *window;         // Ring of the last window_size values
+    int window_size;
+    int window_next;            // Slot the next value overwrites
+    int window_fill;            // Values in the ring, up to window_size
+    long long window_sum;       // Exact sum of the ring
+} RollingStat;
+
+/*
+* Live arrival source of --stream (scheduler_stream_utils.h)
+* Records are read from a descriptor only when the engine asks for the next arrival. A process gets a slot when it
+* arrives and gives it back when it completes, so memory follows the processes in flight, not the length of the stream.
+*/
+#define STREAM_BUFFER_SIZE 65536
+#define STREAM_SLAB 1024        // Process slots allocated at a time
+#define DEFAULT_STREAM_WINDOW 100
+
+#define DEFAULT_BENCH_MAX 10000000  // --bench without a size runs 10^3 .. 10^7 processes
+
+struct ArrivalStream {
+    int fd;
+    const char *name;           // For messages
+    char *buf;                  // STREAM_BUFFER_SIZE bytes of read-ahead
+    size_t buf_pos, buf_len;    // Unparsed bytes are buf[buf_pos, buf_len)
+    bool eof;                   // Nothing more will be read from fd
+    int line;                   // Lines consumed, for messages
+    bool has_pending;           // pending holds the next record, read but not handed out yet
+    Process pending;
+    sim_time_t last_arrival;    // Arrivals handed to the engine never go back in time
+    Process **free_slots;       // Slots of completed processes, reused before a new slab is allocated
+    int free_count, free_capacity;
+    Process **slabs;
+    int slab_count, slab_capacity;
+    long long received;         // Records read
+    long long completed;
+    int in_flight;              // Arrived and not completed
+    int peak_in_flight;
+    RollingStat waiting;
+    RollingStat response;       // first dispatch - arrival
+    RollingStat turnaround;     // finish - arrival
+};
+
+
+/*
+* Command-line options of the simulator
+*/
+typedef struct {
+    ProcessLayout layout;
+    const char *trace_path;     // Trace given on the command line, NULL to probe input.txt, input0.txt, ...
+    const char *write_binary;   // Convert the loaded trace to this binary file and exit
+    bool compare;               // Run every algorithm on the trace and print one comparison table
+    int quanta[MAX_COMPARE_QUANTA];     // RR quanta compared, trace quantum (or DEFAULT_COMPARE_QUANTUM) when empty
+    int quantum_count;
+    int threads;                // Worker threads for --compare and --sweep, 0 for one per online CPU
+    const char *sweep;          // Directory or manifest of traces to sweep, NULL for a single run
+    const char *algos;          // Comma list of algorithms swept ("all" for every one), NULL for each trace's own
+    ResultFormat format;
+    const char *output;         // File the sweep results go to, NULL for stdout
+    const char *stream;         // Arrival stream to schedule online: "-" for stdin, a file or FIFO, or tcp:host:port
+    int window;                 // Completions the rolling averages of --stream cover
+    int bench_max;              // --bench: largest generated trace, 0 when not benchmarking
+} SchedOptions;
+
+typedef struct TraceGenConfig TraceGenConfig;                   // Synthetic workload shape (trace_gen.h)
+
+extern SchedOptions gSchedOptions;
+
+
 // Declaration of algorithm Functions
 void sjf(Process procs[], int n);
 void PR_PREMP(Process procs[], int n);
 void pr_noPREMP(Process procs[], int n);
 void round_robin(Process procs[], int n, int quantum);
+void run_nonpreemptive(Process procs[], int n, bool (*better)(const Process *, const Process *));   // Shared core of SJF and PR_noPREMP
+void round_robin_events(SimEngine *eng, int quantum);                           // The algorithms proper, on any engine (batch or stream)
+void nonpreemptive_events(SimEngine *eng, bool (*better)(const Process *, const Process *));
+void preemptive_priority_events(SimEngine *eng);
+bool shorter_burst(const Process *a, const Process *b);                         // SJF ordering
+bool higher_priority(const Process *a, const Process *b);                       // Priority ordering, lower number first
+void run_nonpreemptive_soa(Process procs[], int n, SelectKey key);              // Same schedule as run_nonpreemptive on a ProcessTable
 
 // Declaration of helper function
 void print_process_burst_times(Process procs[], int n);                         // Function to print the CPU burst times for all processes  
 void calculate_waiting_average(Process procs[], int n);                         // Function to calculate and print the average waiting time for all processes
 void print_process_time_results(Process procs[], int n);                        // Function to print the results for process times
-void calculate_waiting_time(Process *proc, int current_time);                   // Function to calculate the waiting time for a process based on current simulation time
+void calculate_waiting_time(Process *proc, sim_time_t current_time);            // Function to calculate the waiting time for a process based on current simulation time
 void execute_schedule(const char* algo, Process* procs, int n, int quantum);    // Function to execute scheduling based on the specified algorithm
-int initialize_scheduling(const char* filename_base, Process* procs, int* n, char* scheduling_algo, int* quantum);      // Function to initialize scheduling from a specified file base name
+int initialize_scheduling(const char* filename_base, Process** procs, int* n, char* scheduling_algo, int* quantum);     // Function to initialize scheduling from a specified file base name, allocates *procs
+int parse_sched_option(const char* arg, SchedOptions* opts);                    // Returns 0 if the argument was a valid option, -1 otherwise
+int run_algorithm(const char* algo, Process* procs, int n, int quantum);       // Dispatch without printing, -1 for an unknown name
+int run_algorithm_events(const char* algo, SimEngine* eng, int quantum);      // Same dispatch on an engine that is already set up
+void compare_schedules(const Process procs[], int n, int trace_quantum);      // --compare: all algorithms on a thread pool, prints the table
+int run_job_pool(CompareJob jobs[], int job_count, int threads);              // Run the jobs on a pthread pool, returns the threads used
+int sweep_schedules(const char *source);                                       // --sweep: every trace of a directory or manifest over the parameter grid
+int load_trace(const char *path, Process **procs, int *n, char *scheduling_algo, int *quantum);   // Map and parse a text or binary trace, allocates *procs
+int write_binary_trace(const char *path, const Process procs[], int n, const char *scheduling_algo, int quantum);
+int stream_schedules(const char *source);                                      // --stream: schedule arrivals as they are read, print completions as they happen
+int bench_schedules(const TraceGenConfig *cfg, int max_count);                 // --bench: time every algorithm on generated traces of 10^3 .. max_count processes
+
+
+// Declaration of engine functions
+void engine_init(SimEngine *eng, Process procs[], int n);                      // Sort the processes by arrival and start the clock at 0
+void engine_init_stream(SimEngine *eng, ArrivalStream *stream);                 // Draw the arrivals from stream instead, start the clock at 0
+void engine_free(SimEngine *eng);                                               // Release the arrival order
+bool engine_done(SimEngine *eng);                                               // Every process has arrived and completed (may read the stream)
+Process *engine_pop_arrival(SimEngine *eng);                                    // Next process with arrival_time <= now, NULL if none has arrived yet
+sim_time_t engine_next_arrival_time(SimEngine *eng);                            // Arrival time of the next process still to arrive, SIM_TIME_NEVER if none
+void engine_idle(SimEngine *eng);                                               // Nothing is ready: jump the clock to the next arrival
+bool engine_run(SimEngine *eng, Process *proc, sim_time_t slice);               // Run proc for up to slice ticks, true if it completed
+
+// Declaration of queue functions
+void queue_init(Queue *queue, int capacity);                                   // Empty queue with room for at least capacity processes
+void queue_free(Queue *queue);
+void queue_push_back(Queue *queue, Process *proc);                             // O(1) amortized
+void queue_push_front(Queue *queue, Process *proc);                            // O(1) amortized
+Process *queue_pop_front(Queue *queue);                                        // NULL if empty, O(1)
+
+// Declaration of ready heap functions
+void heap_init(ProcessHeap *heap, int capacity, bool (*better)(const Process *, const Process *));  // Empty heap ordered by better()
+void heap_free(ProcessHeap *heap);
+void heap_push(ProcessHeap *heap, Process *proc);                              // O(log n)
+Process *heap_pop(ProcessHeap *heap);                                          // Remove the preferred process, NULL if empty; O(log n)
+Process *heap_peek(const ProcessHeap *heap);                                   // Preferred process without removing it, NULL if empty
+Process *heap_replace_top(ProcessHeap *heap, Process *proc);                   // Swap proc in for the preferred process, returns it; O(log n)
+
+// Declaration of process table functions
+void table_init(ProcessTable *table, const Process procs[], int n, SelectKey key);   // Arrival-ordered SoA copy of procs
+void table_free(ProcessTable *table);
+int table_select_min(const ProcessTable *table, int from, int to);             // Entry in [from, to) with the smallest key, ties by process_number; -1 if all completed
+void table_store_results(const ProcessTable *table, Process procs[]);          // Copy finish, start, response and waiting times back
+
+// Declaration of arrival stream functions
+Process *stream_pop_arrival(ArrivalStream *stream, sim_time_t now);             // Next record with arrival_time <= now in a fresh slot, NULL if none
+sim_time_t stream_next_arrival_time(ArrivalStream *stream);                     // Blocks until the next record is read, SIM_TIME_NEVER at the end
+void stream_retire(ArrivalStream *stream, Process *proc);                       // Report a completed process and recycle its slot
 
 
 #endif 
@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "scheduler.h"
+#include "trace_gen.h"
+
+/*
+* Benchmark mode
+* Every algorithm runs on generated traces of 10^3, 10^4, ... processes, one after the other on a single thread.
+* The timed part is what a real run does: sorting the arrivals and simulating. Copying the trace in is not timed.
+* Peak RSS is the process high-water mark so far, so it only ever grows down the table.
+*/
+
+static const char *bench_algorithms[] = { "RR", "SJF", "PR_noPREMP", "PR_withPREMP" };
+
+static double bench_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/***** BENCH SCHEDULES *****/
+int bench_schedules(const TraceGenConfig *cfg, int max_count) {
+    int quantum = gSchedOptions.quantum_count > 0 ? gSchedOptions.quanta[0] : DEFAULT_COMPARE_QUANTUM;
+
+    printf("Benchmarking on %s arrivals (mean gap %.1f), %s bursts (mean %.1f), RR quantum %d\n\n",
+           cfg->arrival == ARRIVAL_POISSON ? "Poisson" : "bursty", cfg->mean_interarrival,
+           cfg->burst == BURST_EXPONENTIAL ? "exponential" : "Pareto", cfg->mean_burst, quantum);
+    printf("   Processes     Algorithm         Events     Seconds       Events/s   Peak RSS (MB)\n");
+    printf("-------------------------------------------------------------------------------------\n");
+
+    for (long long count = 1000; count <= max_count; count *= 10) {
+        int n = (int) count;
+        Process *source = malloc((size_t) n * sizeof(Process));
+        Process *procs = malloc((size_t) n * sizeof(Process));
+        if (source == NULL || procs == NULL) {
+            fprintf(stderr, "Unable to allocate %d processes, stopping here\n", n);
+            free(source);
+            free(procs);
+            break;
+        }
+        generate_trace(cfg, source, n);
+
+        for (int a = 0; a < 4; a++) {
+            SimEngine eng;
+            memcpy(procs, source, (size_t) n * sizeof(Process));
+
+            double start = bench_seconds();
+            engine_init(&eng, procs, n);
+            run_algorithm_events(bench_algorithms[a], &eng, quantum);
+            engine_free(&eng);
+            double elapsed = bench_seconds() - start;
+
+            struct rusage usage;
+            getrusage(RUSAGE_SELF, &usage);                          // ru_maxrss is in kilobytes on Linux
+            printf("%12d %13s %14lld %11.4f %14.0f %15.1f\n", n, bench_algorithms[a], eng.events, elapsed,
+                   elapsed > 0.0 ? eng.events / elapsed : 0.0, usage.ru_maxrss / 1024.0);
+            fflush(stdout);                                          // Large sizes take a while, show each row as it lands
+        }
+        free(source);
+        free(procs);
+    }
+    return 0;
+}
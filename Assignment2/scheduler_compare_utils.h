@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "scheduler.h"
+
+/*
+* Comparison mode and the job pool it shares with --sweep
+* A trace is loaded once; every job copies it into private memory when a pool thread picks the job up,
+* so the algorithms run side by side, never touch each other's state, and only running jobs hold a copy.
+*/
+
+typedef struct {
+    CompareJob *jobs;
+    int job_count;
+    atomic_int next_job;        // Index of the next job nobody has taken yet
+} ComparePool;
+
+/***** SUMMARY *****/
+static void summarize_job(CompareJob *job) {
+    int n = job->n;
+    double waiting = 0.0, turnaround = 0.0, response = 0.0;
+    sim_time_t makespan = 0;
+
+    for (int i = 0; i < n; i++) {
+        const Process *proc = &job->procs[i];
+        waiting += proc->waiting_time;
+        turnaround += proc->finish_time - proc->arrival_time;
+        response += proc->response_time;
+        if (proc->finish_time > makespan) {
+            makespan = proc->finish_time;
+        }
+    }
+    job->avg_waiting = waiting / n;
+    job->avg_turnaround = turnaround / n;
+    job->avg_response = response / n;
+    job->makespan = makespan;
+}
+
+/***** WORKER *****/
+static void *compare_worker(void *param) {
+    ComparePool *pool = param;
+    int i;
+
+    while ((i = atomic_fetch_add(&pool->next_job, 1)) < pool->job_count) {
+        CompareJob *job = &pool->jobs[i];
+        job->procs = malloc((size_t) job->n * sizeof(Process));
+        if (job->procs == NULL) {
+            perror("Unable to allocate a process copy");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(job->procs, job->source, (size_t) job->n * sizeof(Process));
+        job->status = run_algorithm(job->algo, job->procs, job->n, job->quantum);
+        if (job->status == 0) {
+            summarize_job(job);
+        }
+        free(job->procs);                                            // Only the averages are kept
+        job->procs = NULL;
+    }
+    return NULL;
+}
+
+/***** JOB POOL *****/
+// Run every job on up to threads threads (0 for one per online CPU), returns the number of threads used
+int run_job_pool(CompareJob jobs[], int job_count, int threads) {
+    ComparePool pool;
+    pool.jobs = jobs;
+    pool.job_count = job_count;
+    atomic_init(&pool.next_job, 0);
+
+    if (threads <= 0) {
+        threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads > job_count) {
+        threads = job_count;                                         // More threads than jobs would only sit idle
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    pthread_t tid[threads];
+    int started = 0;
+    for (int t = 0; t < threads; t++) {
+        if (pthread_create(&tid[t], NULL, compare_worker, &pool) != 0) {
+            break;                                                   // The threads we have still drain the whole job list
+        }
+        started++;
+    }
+    if (started == 0) {
+        compare_worker(&pool);                                       // No thread could be created, run everything here
+        return 1;
+    }
+    for (int t = 0; t < started; t++) {
+        pthread_join(tid[t], NULL);
+    }
+    return started;
+}
+
+static void add_job(CompareJob jobs[], int *job_count, const char *trace, const char *algo, int quantum, const Process procs[], int n) {
+    CompareJob *job = &jobs[(*job_count)++];
+    memset(job, 0, sizeof(*job));
+    job->trace = trace;
+    job->algo = algo;
+    job->quantum = quantum;
+    job->source = procs;
+    job->n = n;
+}
+
+/***** COMPARE SCHEDULES *****/
+void compare_schedules(const Process procs[], int n, int trace_quantum) {
+    int quanta[MAX_COMPARE_QUANTA];
+    int quantum_count = gSchedOptions.quantum_count;
+    CompareJob *jobs;
+    int job_count = 0;
+
+    if (quantum_count > 0) {
+        memcpy(quanta, gSchedOptions.quanta, quantum_count * sizeof(int));
+    } else {
+        quanta[0] = trace_quantum > 0 ? trace_quantum : DEFAULT_COMPARE_QUANTUM;
+        quantum_count = 1;
+    }
+
+    jobs = malloc((quantum_count + 3) * sizeof(CompareJob));
+    if (jobs == NULL) {
+        perror("Unable to allocate the --compare jobs");
+        exit(EXIT_FAILURE);
+    }
+    for (int q = 0; q < quantum_count; q++) {
+        add_job(jobs, &job_count, NULL, "RR", quanta[q], procs, n);
+    }
+    add_job(jobs, &job_count, NULL, "SJF", 0, procs, n);
+    add_job(jobs, &job_count, NULL, "PR_noPREMP", 0, procs, n);
+    add_job(jobs, &job_count, NULL, "PR_withPREMP", 0, procs, n);
+
+    int started = run_job_pool(jobs, job_count, gSchedOptions.threads);
+
+    printf("\nComparing %d schedules of %d processes on %d thread%s\n", job_count, n, started, started == 1 ? "" : "s");
+    printf("   Algorithm   Quantum    Avg Waiting  Avg Turnaround   Avg Response       Makespan\n");
+    printf("-------------------------------------------------------------------------------------\n");
+    for (int i = 0; i < job_count; i++) {
+        const CompareJob *job = &jobs[i];
+        char quantum[16] = "-";
+        if (strcmp(job->algo, "RR") == 0) {
+            snprintf(quantum, sizeof(quantum), "%d", job->quantum);
+        }
+        printf("%12s %9s %14.2f %15.2f %14.2f %14lld\n", job->algo, quantum, job->avg_waiting, job->avg_turnaround, job->avg_response, job->makespan);
+    }
+    free(jobs);
+}
@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "scheduler.h"
+
+/***** ARRIVAL ORDER *****/
+static int compare_arrival(const void *a, const void *b) {
+    const Process *pa = *(Process * const *)a;
+    const Process *pb = *(Process * const *)b;
+    if (pa->arrival_time != pb->arrival_time) {
+        return pa->arrival_time < pb->arrival_time ? -1 : 1;
+    }
+    return pa < pb ? -1 : (pa > pb);                                // Same arrival: keep input order, like the original index scans
+}
+
+/***** ENGINE SETUP *****/
+void engine_init(SimEngine *eng, Process procs[], int n) {
+    eng->by_arrival = malloc((n > 0 ? n : 1) * sizeof(Process *));
+    if (eng->by_arrival == NULL) {
+        perror("Unable to allocate the arrival order");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < n; i++) {
+        procs[i].remaining_time = procs[i].cpu_burst_time;           // Every algorithm starts from a fresh copy of the bursts
+        procs[i].has_started = false;
+        eng->by_arrival[i] = &procs[i];
+    }
+    qsort(eng->by_arrival, n, sizeof(Process *), compare_arrival);  // Sorted once, O(n log n) for the whole run
+    eng->n = n;
+    eng->next_arrival = 0;
+    eng->completed = 0;
+    eng->now = 0;
+    eng->stream = NULL;
+    eng->events = 0;
+}
+
+void engine_init_stream(SimEngine *eng, ArrivalStream *stream) {
+    eng->by_arrival = NULL;
+    eng->n = 0;                                                      // Unknown up front, the stream says when it is over
+    eng->next_arrival = 0;
+    eng->completed = 0;
+    eng->now = 0;
+    eng->stream = stream;
+    eng->events = 0;
+}
+
+void engine_free(SimEngine *eng) {
+    free(eng->by_arrival);
+    eng->by_arrival = NULL;
+}
+
+bool engine_done(SimEngine *eng) {
+    if (eng->stream != NULL) {
+        return eng->stream->in_flight == 0 && stream_next_arrival_time(eng->stream) == SIM_TIME_NEVER;
+    }
+    return eng->completed == eng->n;
+}
+
+/***** ARRIVALS *****/
+Process *engine_pop_arrival(SimEngine *eng) {
+    Process *proc = NULL;
+    if (eng->stream != NULL) {
+        proc = stream_pop_arrival(eng->stream, eng->now);
+    } else if (eng->next_arrival < eng->n && eng->by_arrival[eng->next_arrival]->arrival_time <= eng->now) {
+        proc = eng->by_arrival[eng->next_arrival++];
+    }
+    eng->events += proc != NULL;
+    return proc;
+}
+
+sim_time_t engine_next_arrival_time(SimEngine *eng) {
+    if (eng->stream != NULL) {
+        return stream_next_arrival_time(eng->stream);
+    }
+    return eng->next_arrival < eng->n ? eng->by_arrival[eng->next_arrival]->arrival_time : SIM_TIME_NEVER;
+}
+
+void engine_idle(SimEngine *eng) {
+    sim_time_t next = engine_next_arrival_time(eng);
+    if (next != SIM_TIME_NEVER && next > eng->now) {
+        eng->now = next;                                             // Skip the idle gap in one step instead of one tick at a time
+    }
+}
+
+/***** EXECUTION *****/
+bool engine_run(SimEngine *eng, Process *proc, sim_time_t slice) {
+    if (!proc->has_started) {
+        proc->has_started = true;
+        proc->start_time = eng->now;
+        proc->response_time = eng->now - proc->arrival_time;         // First dispatch
+    }
+    if (slice > proc->remaining_time) {
+        slice = proc->remaining_time;
+    }
+    proc->remaining_time -= slice;
+    eng->now += slice;
+    eng->events++;
+    proc->last_execution_time = eng->now;                            // Left the CPU here, completed or not
+
+    if (proc->remaining_time > 0) {
+        return false;
+    }
+    proc->finish_time = eng->now;                                    // Set finish time for the process
+    calculate_waiting_time(proc, eng->now);                          // Calculate waiting time
+    eng->completed++;
+    if (eng->stream != NULL) {
+        stream_retire(eng->stream, proc);                            // Reported and recycled, the caller must not touch proc again
+    }
+    return true;
+}
+
+/***** READY QUEUE *****/
+void queue_init(Queue *queue, int capacity) {
+    queue->capacity = 16;
+    while (queue->capacity < capacity) {
+        queue->capacity *= 2;
+    }
+    queue->processes = malloc(queue->capacity * sizeof(Process *));
+    if (queue->processes == NULL) {
+        perror("Unable to allocate the ready queue");
+        exit(EXIT_FAILURE);
+    }
+    queue->head = 0;
+    queue->count = 0;
+}
+
+void queue_free(Queue *queue) {
+    free(queue->processes);
+    queue->processes = NULL;
+    queue->head = queue->count = queue->capacity = 0;
+}
+
+// Double the ring, unwrapping the contents so the front lands at slot 0
+static void queue_grow(Queue *queue) {
+    Process **grown = malloc(2 * queue->capacity * sizeof(Process *));
+    if (grown == NULL) {
+        perror("Unable to grow the ready queue");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < queue->count; i++) {
+        grown[i] = queue->processes[(queue->head + i) & (queue->capacity - 1)];
+    }
+    free(queue->processes);
+    queue->processes = grown;
+    queue->head = 0;
+    queue->capacity *= 2;
+}
+
+void queue_push_back(Queue *queue, Process *proc) {
+    if (queue->count == queue->capacity) {
+        queue_grow(queue);
+    }
+    queue->processes[(queue->head + queue->count++) & (queue->capacity - 1)] = proc;
+}
+
+void queue_push_front(Queue *queue, Process *proc) {
+    if (queue->count == queue->capacity) {
+        queue_grow(queue);
+    }
+    queue->head = (queue->head - 1) & (queue->capacity - 1);
+    queue->processes[queue->head] = proc;
+    queue->count++;
+}
+
+Process *queue_pop_front(Queue *queue) {
+    if (queue->count == 0) {
+        return NULL;
+    }
+    Process *proc = queue->processes[queue->head];
+    queue->head = (queue->head + 1) & (queue->capacity - 1);
+    queue->count--;
+    return proc;
+}
+
+/***** READY HEAP *****/
+static bool heap_before(const ProcessHeap *heap, const Process *a, const Process *b) {
+    if (heap->better(a, b)) {
+        return true;
+    }
+    if (heap->better(b, a)) {
+        return false;
+    }
+    return a->process_number < b->process_number;                    // Deterministic tie-break
+}
+
+void heap_init(ProcessHeap *heap, int capacity, bool (*better)(const Process *, const Process *)) {
+    heap->capacity = capacity > 0 ? capacity : 16;
+    heap->items = malloc(heap->capacity * sizeof(Process *));
+    if (heap->items == NULL) {
+        perror("Unable to allocate the ready heap");
+        exit(EXIT_FAILURE);
+    }
+    heap->count = 0;
+    heap->better = better;
+}
+
+void heap_free(ProcessHeap *heap) {
+    free(heap->items);
+    heap->items = NULL;
+    heap->count = heap->capacity = 0;
+}
+
+void heap_push(ProcessHeap *heap, Process *proc) {
+    if (heap->count == heap->capacity) {
+        Process **grown = realloc(heap->items, 2 * heap->capacity * sizeof(Process *));
+        if (grown == NULL) {
+            perror("Unable to grow the ready heap");
+            exit(EXIT_FAILURE);
+        }
+        heap->items = grown;
+        heap->capacity *= 2;
+    }
+
+    int i = heap->count++;
+    while (i > 0) {                                                  // Sift up
+        int parent = (i - 1) / 2;
+        if (!heap_before(heap, proc, heap->items[parent])) {
+            break;
+        }
+        heap->items[i] = heap->items[parent];
+        i = parent;
+    }
+    heap->items[i] = proc;
+}
+
+Process *heap_pop(ProcessHeap *heap) {
+    if (heap->count == 0) {
+        return NULL;
+    }
+    Process *top = heap->items[0];
+    Process *last = heap->items[--heap->count];
+
+    int i = 0;
+    while (true) {                                                   // Sift the last item down from the root
+        int child = 2 * i + 1;
+        if (child >= heap->count) {
+            break;
+        }
+        if (child + 1 < heap->count && heap_before(heap, heap->items[child + 1], heap->items[child])) {
+            child++;
+        }
+        if (!heap_before(heap, heap->items[child], last)) {
+            break;
+        }
+        heap->items[i] = heap->items[child];
+        i = child;
+    }
+    if (heap->count > 0) {
+        heap->items[i] = last;
+    }
+    return top;
+}
+
+Process *heap_peek(const ProcessHeap *heap) {
+    return heap->count > 0 ? heap->items[0] : NULL;
+}
+
+// Pop and push in one sift-down: the top leaves, proc takes its place
+Process *heap_replace_top(ProcessHeap *heap, Process *proc) {
+    if (heap->count == 0) {
+        heap_push(heap, proc);
+        return NULL;
+    }
+    Process *top = heap->items[0];
+
+    int i = 0;
+    while (true) {
+        int child = 2 * i + 1;
+        if (child >= heap->count) {
+            break;
+        }
+        if (child + 1 < heap->count && heap_before(heap, heap->items[child + 1], heap->items[child])) {
+            child++;
+        }
+        if (!heap_before(heap, heap->items[child], proc)) {
+            break;
+        }
+        heap->items[i] = heap->items[child];
+        i = child;
+    }
+    heap->items[i] = proc;
+    return top;
+}
+
+/***** STRUCTURE OF ARRAYS *****/
+void table_init(ProcessTable *table, const Process procs[], int n, SelectKey key) {
+    const Process **order = malloc((n > 0 ? n : 1) * sizeof(Process *));
+    table->n = n;
+    table->index = malloc((n > 0 ? n : 1) * sizeof(int));
+    table->process_number = malloc((n > 0 ? n : 1) * sizeof(int));
+    table->arrival_time = malloc((n > 0 ? n : 1) * sizeof(sim_time_t));
+    table->cpu_burst_time = malloc((n > 0 ? n : 1) * sizeof(sim_time_t));
+    table->finish_time = malloc((n > 0 ? n : 1) * sizeof(sim_time_t));
+    table->key = malloc((n > 0 ? n : 1) * sizeof(sim_time_t));
+    if (order == NULL || table->index == NULL || table->process_number == NULL || table->arrival_time == NULL ||
+        table->cpu_burst_time == NULL || table->finish_time == NULL || table->key == NULL) {
+        perror("Unable to allocate the process table");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < n; i++) {
+        order[i] = &procs[i];
+    }
+    qsort(order, n, sizeof(Process *), compare_arrival);             // Same arrival order as the engine
+    for (int i = 0; i < n; i++) {
+        const Process *proc = order[i];
+        table->index[i] = (int) (proc - procs);
+        table->process_number[i] = proc->process_number;
+        table->arrival_time[i] = proc->arrival_time;
+        table->cpu_burst_time[i] = proc->cpu_burst_time;
+        table->finish_time[i] = 0;
+        table->key[i] = key == KEY_BURST ? proc->cpu_burst_time : proc->priority;
+    }
+    free(order);
+}
+
+void table_free(ProcessTable *table) {
+    free(table->index);
+    free(table->process_number);
+    free(table->arrival_time);
+    free(table->cpu_burst_time);
+    free(table->finish_time);
+    free(table->key);
+    table->n = 0;
+}
+
+// Two branch-free reductions: the smallest key, then the smallest (process_number, entry) among the entries holding it
+int table_select_min(const ProcessTable *table, int from, int to) {
+    const sim_time_t *key = table->key;
+    const int *number = table->process_number;
+    sim_time_t best = SIM_TIME_NEVER;
+
+    for (int i = from; i < to; i++) {
+        best = key[i] < best ? key[i] : best;
+    }
+    if (best == SIM_TIME_NEVER) {
+        return -1;
+    }
+
+    unsigned long long best_tag = ULLONG_MAX;
+    for (int i = from; i < to; i++) {
+        unsigned long long tag = ((unsigned long long) ((unsigned int) number[i] ^ 0x80000000u) << 32) | (unsigned int) i;   // Signed order of process_number as unsigned
+        tag = key[i] == best ? tag : ULLONG_MAX;
+        best_tag = tag < best_tag ? tag : best_tag;
+    }
+    return (int) (best_tag & 0xFFFFFFFFu);
+}
+
+void table_store_results(const ProcessTable *table, Process procs[]) {
+    for (int i = 0; i < table->n; i++) {
+        Process *proc = &procs[table->index[i]];
+        proc->finish_time = table->finish_time[i];
+        proc->start_time = table->finish_time[i] - table->cpu_burst_time[i];
+        proc->response_time = proc->start_time - proc->arrival_time;
+        proc->last_execution_time = proc->finish_time;               // Non-preemptive: one run, start to finish
+        proc->remaining_time = 0;
+        proc->has_started = true;
+        calculate_waiting_time(proc, proc->finish_time);
+    }
+}
@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "scheduler.h"
+
+/*
+* Trace loading
+* The whole file is mapped and parsed in place: a text trace by a small integer scanner instead of fscanf,
+* a binary trace (TRACE_BINARY_MAGIC) by copying fixed-size records.
+*/
+
+/***** TEXT SCANNER *****/
+typedef struct {
+    const char *p;              // Next unread byte
+    const char *end;            // One past the last byte of the mapping
+} TraceScanner;
+
+static void scan_skip_space(TraceScanner *sc) {
+    while (sc->p < sc->end && (*sc->p == ' ' || *sc->p == '\t' || *sc->p == '\n' || *sc->p == '\r')) {
+        sc->p++;
+    }
+}
+
+// Next whitespace separated word, false if none or longer than cap - 1
+static bool scan_word(TraceScanner *sc, char *out, size_t cap) {
+    size_t len = 0;
+    scan_skip_space(sc);
+    while (sc->p < sc->end && *sc->p != ' ' && *sc->p != '\t' && *sc->p != '\n' && *sc->p != '\r') {
+        if (len + 1 >= cap) {
+            return false;
+        }
+        out[len++] = *sc->p++;
+    }
+    out[len] = '\0';
+    return len > 0;
+}
+
+// Next decimal integer with optional sign, false on anything else or on overflow
+static bool scan_ll(TraceScanner *sc, long long *out) {
+    bool negative = false;
+    unsigned long long val = 0;
+
+    scan_skip_space(sc);
+    if (sc->p < sc->end && (*sc->p == '-' || *sc->p == '+')) {
+        negative = *sc->p++ == '-';
+    }
+    const char *digits = sc->p;
+    while (sc->p < sc->end && *sc->p >= '0' && *sc->p <= '9') {
+        unsigned d = (unsigned) (*sc->p++ - '0');
+        if (val > ((unsigned long long) LLONG_MAX - d) / 10) {
+            return false;                                   // Checked before multiplying, val * 10 + d could wrap
+        }
+        val = val * 10 + d;
+    }
+    if (sc->p == digits) {
+        return false;
+    }
+    *out = negative ? -(long long) val : (long long) val;
+    return true;
+}
+
+static bool scan_int(TraceScanner *sc, int *out) {
+    long long val;
+    if (!scan_ll(sc, &val) || val < INT_MIN || val > INT_MAX) {
+        return false;
+    }
+    *out = (int) val;
+    return true;
+}
+
+static void init_process(Process *proc) {
+    proc->remaining_time = proc->cpu_burst_time;                     // Set remaining time equal to CPU burst time
+    proc->has_started = false;                                       // Mark process as not started
+    proc->start_time = proc->finish_time = proc->response_time = proc->waiting_time = proc->last_execution_time = 0;  // Initialize all timing data
+}
+
+static Process *alloc_processes(int n) {
+    Process *procs = malloc((size_t) n * sizeof(Process));           // Sized from the trace instead of a fixed cap
+    if (procs == NULL) {
+        perror("Unable to allocate the process table");
+    }
+    return procs;
+}
+
+static int parse_text_trace(TraceScanner *sc, Process **procs_out, int *n, char *scheduling_algo, int *quantum) {
+    if (!scan_word(sc, scheduling_algo, TRACE_ALGO_LEN)) {           // Attempt to read scheduling algorithm from file
+        fprintf(stderr, "Failed to read scheduling algorithm\n");
+        return -1;
+    }
+    if (strcmp(scheduling_algo, "RR") == 0 && !scan_int(sc, quantum)) {     // If algorithm is Round Robin, read quantum value
+        fprintf(stderr, "Failed to read quantum for RR\n");
+        return -1;
+    }
+    if (!scan_int(sc, n) || *n <= 0) {                               // Attempt to read number of processes
+        fprintf(stderr, "Failed to read number of processes\n");
+        return -1;
+    }
+
+    Process *procs = alloc_processes(*n);
+    if (procs == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < *n; i++) {                                   // Loop to read data for each process
+        Process *proc = &procs[i];
+        if (!scan_int(sc, &proc->process_number) || !scan_ll(sc, &proc->arrival_time) ||
+            !scan_ll(sc, &proc->cpu_burst_time) || !scan_int(sc, &proc->priority)) {
+            fprintf(stderr, "Failed to read data for process %d\n", i);
+            free(procs);
+            return -1;
+        }
+        init_process(proc);
+    }
+    *procs_out = procs;
+    return 0;
+}
+
+/***** BINARY TRACE *****/
+static int parse_binary_trace(const char *data, size_t size, Process **procs_out, int *n, char *scheduling_algo, int *quantum) {
+    TraceBinaryHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.version != TRACE_BINARY_VERSION || header.count == 0 || header.count > INT_MAX ||
+        (size - sizeof(header)) / sizeof(TraceBinaryRecord) < header.count) {
+        fprintf(stderr, "Binary trace is truncated or of an unsupported version\n");
+        return -1;
+    }
+    memcpy(scheduling_algo, header.algo, TRACE_ALGO_LEN);
+    scheduling_algo[TRACE_ALGO_LEN - 1] = '\0';
+    *quantum = header.quantum;
+    *n = (int) header.count;
+
+    Process *procs = alloc_processes(*n);
+    if (procs == NULL) {
+        return -1;
+    }
+    const char *rec_ptr = data + sizeof(header);
+    for (int i = 0; i < *n; i++, rec_ptr += sizeof(TraceBinaryRecord)) {
+        TraceBinaryRecord rec;
+        memcpy(&rec, rec_ptr, sizeof(rec));                          // The mapping gives no alignment guarantee past the header
+        procs[i].process_number = rec.process_number;
+        procs[i].priority = rec.priority;
+        procs[i].arrival_time = rec.arrival_time;
+        procs[i].cpu_burst_time = rec.cpu_burst_time;
+        init_process(&procs[i]);
+    }
+    *procs_out = procs;
+    return 0;
+}
+
+/***** LOAD TRACE *****/
+int load_trace(const char *path, Process **procs_out, int *n, char *scheduling_algo, int *quantum) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "Error opening %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        fprintf(stderr, "Error reading %s: empty or unreadable\n", path);
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t) st.st_size;
+    const char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);                                                       // The mapping stays valid without the descriptor
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Error mapping %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    madvise((void *) data, size, MADV_SEQUENTIAL);                   // One front-to-back pass, let the kernel read ahead
+
+    int rc;
+    if (size >= sizeof(TraceBinaryHeader) && memcmp(data, TRACE_BINARY_MAGIC, 4) == 0) {
+        rc = parse_binary_trace(data, size, procs_out, n, scheduling_algo, quantum);
+    } else {
+        TraceScanner sc = { data, data + size };
+        rc = parse_text_trace(&sc, procs_out, n, scheduling_algo, quantum);
+    }
+    munmap((void *) data, size);
+    return rc;
+}
+
+int write_binary_trace(const char *path, const Process procs[], int n, const char *scheduling_algo, int quantum) {
+    FILE *out = fopen(path, "wb");
+    if (out == NULL) {
+        fprintf(stderr, "Error creating %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    TraceBinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_BINARY_MAGIC, 4);
+    header.version = TRACE_BINARY_VERSION;
+    strncpy(header.algo, scheduling_algo, TRACE_ALGO_LEN - 1);
+    header.quantum = quantum;
+    header.count = (uint64_t) n;
+    fwrite(&header, sizeof(header), 1, out);
+
+    for (int i = 0; i < n; i++) {
+        TraceBinaryRecord rec = { procs[i].process_number, procs[i].priority, procs[i].arrival_time, procs[i].cpu_burst_time };
+        fwrite(&rec, sizeof(rec), 1, out);
+    }
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Error writing %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,336 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include "scheduler.h"
+
+/*
+* Streaming mode
+* The stream starts like a trace (algorithm, then the quantum for RR) followed by one "process arrival burst priority"
+* record per line; a line holding a single number (the process count of a trace file) is ignored, so a trace can be piped in as is.
+* Arrivals must come in non-decreasing order. An arrival is scheduled once the record after it has been read (or the stream
+* has ended), since the algorithms need to know whether anything else arrives at the same time.
+*/
+
+/***** ROLLING STATISTICS *****/
+static void rolling_init(RollingStat *stat, int window_size) {
+    memset(stat, 0, sizeof(*stat));
+    stat->window_size = window_size;
+    stat->window = malloc(window_size * sizeof(sim_time_t));
+    if (stat->window == NULL) {
+        perror("Unable to allocate the rolling window");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void rolling_free(RollingStat *stat) {
+    free(stat->window);
+    stat->window = NULL;
+}
+
+static void rolling_add(RollingStat *stat, sim_time_t value) {
+    stat->count++;
+    stat->sum += value;
+    if (value > stat->max) {
+        stat->max = value;
+    }
+    if (stat->window_fill == stat->window_size) {
+        stat->window_sum -= stat->window[stat->window_next];         // Oldest value leaves the window
+    } else {
+        stat->window_fill++;
+    }
+    stat->window[stat->window_next] = value;
+    stat->window_sum += value;
+    stat->window_next = (stat->window_next + 1) % stat->window_size;
+}
+
+static double rolling_mean(const RollingStat *stat) {
+    return stat->count > 0 ? stat->sum / stat->count : 0.0;
+}
+
+static double rolling_window_mean(const RollingStat *stat) {
+    return stat->window_fill > 0 ? (double) stat->window_sum / stat->window_fill : 0.0;
+}
+
+/***** SOURCE *****/
+// "tcp:host:port" connects to a server that writes the stream
+static int stream_connect(const char *spec) {
+    char host[256];
+    const char *colon = strrchr(spec, ':');
+    if (colon == NULL || colon == spec || (size_t) (colon - spec) >= sizeof(host)) {
+        fprintf(stderr, "Expected tcp:host:port, got 'tcp:%s'\n", spec);
+        return -1;
+    }
+    memcpy(host, spec, colon - spec);
+    host[colon - spec] = '\0';
+
+    struct addrinfo hints, *res, *ai;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    int rc = getaddrinfo(host, colon + 1, &hints, &res);
+    if (rc != 0) {
+        fprintf(stderr, "Unable to resolve %s: %s\n", spec, gai_strerror(rc));
+        return -1;
+    }
+    int fd = -1;
+    for (ai = res; ai != NULL && fd == -1; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd != -1 && connect(fd, ai->ai_addr, ai->ai_addrlen) == -1) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if (fd == -1) {
+        fprintf(stderr, "Unable to connect to %s\n", spec);
+    }
+    return fd;
+}
+
+static int stream_open(const char *source) {
+    if (strcmp(source, "-") == 0) {
+        return STDIN_FILENO;
+    }
+    if (strncmp(source, "tcp:", 4) == 0) {
+        return stream_connect(source + 4);
+    }
+    int fd = open(source, O_RDONLY);                                 // Regular file or FIFO
+    if (fd == -1) {
+        fprintf(stderr, "Error opening %s: %s\n", source, strerror(errno));
+    }
+    return fd;
+}
+
+// Next line without its terminator, NULL once the stream has ended; the line stays valid until the next call
+static char *stream_read_line(ArrivalStream *stream) {
+    while (true) {
+        char *start = stream->buf + stream->buf_pos;
+        char *nl = memchr(start, '\n', stream->buf_len - stream->buf_pos);
+        if (nl != NULL) {
+            *nl = '\0';
+            stream->buf_pos = (size_t) (nl + 1 - stream->buf);
+            stream->line++;
+            return start;
+        }
+        if (stream->eof) {
+            if (stream->buf_pos == stream->buf_len) {
+                return NULL;
+            }
+            stream->buf[stream->buf_len] = '\0';                     // Last line without a newline
+            stream->buf_pos = stream->buf_len;
+            stream->line++;
+            return start;
+        }
+
+        memmove(stream->buf, start, stream->buf_len - stream->buf_pos);   // Keep the partial line, refill behind it
+        stream->buf_len -= stream->buf_pos;
+        stream->buf_pos = 0;
+        if (stream->buf_len == STREAM_BUFFER_SIZE) {
+            fprintf(stderr, "%s: line %d is longer than %d bytes\n", stream->name, stream->line + 1, STREAM_BUFFER_SIZE);
+            exit(EXIT_FAILURE);
+        }
+        ssize_t got = read(stream->fd, stream->buf + stream->buf_len, STREAM_BUFFER_SIZE - stream->buf_len);
+        if (got > 0) {
+            stream->buf_len += (size_t) got;
+        } else if (got == 0 || errno != EINTR) {
+            if (got < 0) {
+                fprintf(stderr, "Error reading %s: %s\n", stream->name, strerror(errno));
+            }
+            stream->eof = true;
+        }
+    }
+}
+
+static bool blank_line(const char *line) {
+    line += strspn(line, " \t\r");
+    return *line == '\0' || *line == '#';
+}
+
+static int stream_read_header(ArrivalStream *stream, char *scheduling_algo, int *quantum) {
+    char *line;
+    while ((line = stream_read_line(stream)) != NULL && blank_line(line)) {
+    }
+    if (line == NULL) {
+        fprintf(stderr, "Failed to read scheduling algorithm\n");
+        return -1;
+    }
+    TraceScanner sc = { line, line + strlen(line) };
+    if (!scan_word(&sc, scheduling_algo, TRACE_ALGO_LEN)) {
+        fprintf(stderr, "Failed to read scheduling algorithm\n");
+        return -1;
+    }
+    if (strcmp(scheduling_algo, "RR") != 0) {
+        return 0;
+    }
+    if (blank_line(sc.p)) {                                          // Quantum on a line of its own
+        while ((line = stream_read_line(stream)) != NULL && blank_line(line)) {
+        }
+        sc.p = line;
+        sc.end = line != NULL ? line + strlen(line) : NULL;
+    }
+    if (sc.p == NULL || !scan_int(&sc, quantum) || *quantum <= 0) {
+        fprintf(stderr, "Failed to read quantum for RR\n");
+        return -1;
+    }
+    return 0;
+}
+
+/***** ARRIVALS *****/
+// Read ahead one record into pending, false at the end of the stream
+static bool stream_fill(ArrivalStream *stream) {
+    char *line;
+    while (!stream->has_pending && (line = stream_read_line(stream)) != NULL) {
+        if (blank_line(line)) {
+            continue;
+        }
+        TraceScanner sc = { line, line + strlen(line) };
+        Process *proc = &stream->pending;
+        if (!scan_int(&sc, &proc->process_number)) {
+            fprintf(stderr, "%s: skipping malformed line %d\n", stream->name, stream->line);
+            continue;
+        }
+        if (blank_line(sc.p)) {
+            continue;                                                // Process count line of a trace file
+        }
+        if (!scan_ll(&sc, &proc->arrival_time) || !scan_ll(&sc, &proc->cpu_burst_time) || !scan_int(&sc, &proc->priority)) {
+            fprintf(stderr, "%s: skipping malformed line %d\n", stream->name, stream->line);
+            continue;
+        }
+        if (proc->arrival_time < stream->last_arrival) {
+            fprintf(stderr, "%s: process %d arrives at %lld, before the previous arrival; moved to %lld\n",
+                    stream->name, proc->process_number, proc->arrival_time, stream->last_arrival);
+            proc->arrival_time = stream->last_arrival;
+        }
+        stream->last_arrival = proc->arrival_time;
+        init_process(proc);
+        stream->received++;
+        stream->has_pending = true;
+    }
+    return stream->has_pending;
+}
+
+sim_time_t stream_next_arrival_time(ArrivalStream *stream) {
+    return stream_fill(stream) ? stream->pending.arrival_time : SIM_TIME_NEVER;
+}
+
+static Process *stream_alloc(ArrivalStream *stream) {
+    if (stream->free_count == 0) {                                   // Every slot is in flight, add a slab
+        Process *slab = malloc(STREAM_SLAB * sizeof(Process));
+        if (stream->slab_count == stream->slab_capacity) {
+            stream->slab_capacity = stream->slab_capacity > 0 ? 2 * stream->slab_capacity : 16;
+            stream->slabs = realloc(stream->slabs, stream->slab_capacity * sizeof(Process *));
+        }
+        if (stream->free_capacity < stream->slab_count * STREAM_SLAB + STREAM_SLAB) {
+            stream->free_capacity = stream->slab_count * STREAM_SLAB + STREAM_SLAB;
+            stream->free_slots = realloc(stream->free_slots, stream->free_capacity * sizeof(Process *));
+        }
+        if (slab == NULL || stream->slabs == NULL || stream->free_slots == NULL) {
+            perror("Unable to allocate process slots");
+            exit(EXIT_FAILURE);
+        }
+        stream->slabs[stream->slab_count++] = slab;
+        for (int i = STREAM_SLAB - 1; i >= 0; i--) {
+            stream->free_slots[stream->free_count++] = &slab[i];
+        }
+    }
+    return stream->free_slots[--stream->free_count];
+}
+
+Process *stream_pop_arrival(ArrivalStream *stream, sim_time_t now) {
+    if (!stream_fill(stream) || stream->pending.arrival_time > now) {
+        return NULL;
+    }
+    Process *proc = stream_alloc(stream);
+    *proc = stream->pending;
+    stream->has_pending = false;
+    if (++stream->in_flight > stream->peak_in_flight) {
+        stream->peak_in_flight = stream->in_flight;
+    }
+    return proc;
+}
+
+/***** COMPLETIONS *****/
+void stream_retire(ArrivalStream *stream, Process *proc) {
+    sim_time_t response = proc->response_time;
+    sim_time_t turnaround = proc->finish_time - proc->arrival_time;
+
+    rolling_add(&stream->waiting, proc->waiting_time);
+    rolling_add(&stream->response, response);
+    rolling_add(&stream->turnaround, turnaround);
+    stream->completed++;
+    stream->in_flight--;
+    printf("%12lld %10d %10lld %10lld %11lld %12.2f %12.2f %12.2f %12.2f %10d\n",
+           proc->finish_time, proc->process_number, proc->waiting_time, response, turnaround,
+           rolling_mean(&stream->waiting), rolling_window_mean(&stream->waiting),
+           rolling_mean(&stream->response), rolling_window_mean(&stream->response), stream->in_flight);
+    stream->free_slots[stream->free_count++] = proc;                 // Retired: the slot goes to the next arrival
+}
+
+/***** STREAM SCHEDULES *****/
+int stream_schedules(const char *source) {
+    ArrivalStream stream;
+    SimEngine eng;
+    char scheduling_algo[TRACE_ALGO_LEN];
+    int quantum = 0;
+    char wait_label[32], resp_label[32];
+
+    memset(&stream, 0, sizeof(stream));
+    stream.name = strcmp(source, "-") == 0 ? "stdin" : source;
+    stream.fd = stream_open(source);
+    if (stream.fd == -1) {
+        return EXIT_FAILURE;
+    }
+    stream.buf = malloc(STREAM_BUFFER_SIZE + 1);                     // One spare byte to terminate a last line without a newline
+    if (stream.buf == NULL) {
+        perror("Unable to allocate the stream buffer");
+        exit(EXIT_FAILURE);
+    }
+    if (stream_read_header(&stream, scheduling_algo, &quantum) != 0) {
+        free(stream.buf);
+        return EXIT_FAILURE;
+    }
+    if (strcmp(scheduling_algo, "RR") != 0 && strcmp(scheduling_algo, "SJF") != 0 &&
+        strcmp(scheduling_algo, "PR_noPREMP") != 0 && strcmp(scheduling_algo, "PR_withPREMP") != 0) {
+        fprintf(stderr, "Invalid scheduling algorithm specified.\n");
+        free(stream.buf);
+        return EXIT_FAILURE;
+    }
+    rolling_init(&stream.waiting, gSchedOptions.window);
+    rolling_init(&stream.response, gSchedOptions.window);
+    rolling_init(&stream.turnaround, gSchedOptions.window);
+
+    setvbuf(stdout, NULL, _IOLBF, 0);                                // One completion per line, visible as it happens even through a pipe
+    printf("Streaming %s scheduling from %s...\n\n", scheduling_algo, stream.name);
+    snprintf(wait_label, sizeof(wait_label), "Wait (%d)", gSchedOptions.window);
+    snprintf(resp_label, sizeof(resp_label), "Resp (%d)", gSchedOptions.window);
+    printf("%12s %10s %10s %10s %11s %12s %12s %12s %12s %10s\n", "Finish", "Process", "Waiting", "Response", "Turnaround",
+           "Avg Wait", wait_label, "Avg Resp", resp_label, "In flight");
+
+    engine_init_stream(&eng, &stream);
+    run_algorithm_events(scheduling_algo, &eng, quantum);
+    engine_free(&eng);
+    printf("\nCompleted %lld processes, at most %d in flight (%d slots allocated)\n",
+           stream.completed, stream.peak_in_flight, stream.slab_count * STREAM_SLAB);
+    printf("Average waiting time: %.2f (max %lld)\n", rolling_mean(&stream.waiting), stream.waiting.max);
+    printf("Average response time: %.2f (max %lld)\n", rolling_mean(&stream.response), stream.response.max);
+    printf("Average turnaround time: %.2f (max %lld)\n", rolling_mean(&stream.turnaround), stream.turnaround.max);
+
+    if (stream.fd != STDIN_FILENO) {
+        close(stream.fd);
+    }
+    for (int i = 0; i < stream.slab_count; i++) {
+        free(stream.slabs[i]);
+    }
+    free(stream.slabs);
+    free(stream.free_slots);
+    free(stream.buf);
+    rolling_free(&stream.waiting);
+    rolling_free(&stream.response);
+    rolling_free(&stream.turnaround);
+    return 0;
+}
@@ -0,0 +1,246 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "scheduler.h"
+
+/*
+* Sweep mode
+* Every trace of a directory or manifest is loaded once, crossed with the algorithm and quantum grid,
+* and the resulting scenarios run on the same job pool as --compare. Results go out as CSV or JSON.
+*/
+
+typedef struct {
+    char path[PATH_MAX];
+    char algo[TRACE_ALGO_LEN];  // Algorithm named in the trace itself
+    int quantum;                // Quantum named in the trace (RR only)
+    Process *procs;
+    int n;
+} SweepTrace;
+
+static const char *sweep_algorithms[] = { "RR", "SJF", "PR_noPREMP", "PR_withPREMP" };
+
+/***** TRACE LIST *****/
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(((const SweepTrace *) a)->path, ((const SweepTrace *) b)->path);
+}
+
+static SweepTrace *add_trace(SweepTrace **traces, int *count, int *capacity, const char *path) {
+    if (*count == *capacity) {
+        *capacity = *capacity > 0 ? 2 * *capacity : 64;
+        SweepTrace *grown = realloc(*traces, *capacity * sizeof(SweepTrace));
+        if (grown == NULL) {
+            perror("Unable to allocate the sweep trace list");
+            exit(EXIT_FAILURE);
+        }
+        *traces = grown;
+    }
+    SweepTrace *trace = &(*traces)[(*count)++];
+    memset(trace, 0, sizeof(*trace));
+    snprintf(trace->path, sizeof(trace->path), "%s", path);
+    return trace;
+}
+
+// A directory contributes every regular, non-hidden file in name order; anything else is a manifest with one path per line
+static int collect_traces(const char *source, SweepTrace **traces, int *count) {
+    struct stat st;
+    int capacity = 0;
+    char path[PATH_MAX];
+
+    if (stat(source, &st) == -1) {
+        perror(source);
+        return -1;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        DIR *dir = opendir(source);
+        struct dirent *entry;
+        if (dir == NULL) {
+            perror(source);
+            return -1;
+        }
+        while ((entry = readdir(dir)) != NULL) {
+            struct stat file_st;
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+            snprintf(path, sizeof(path), "%s/%s", source, entry->d_name);
+            if (stat(path, &file_st) == 0 && S_ISREG(file_st.st_mode)) {
+                add_trace(traces, count, &capacity, path);
+            }
+        }
+        closedir(dir);
+        qsort(*traces, *count, sizeof(SweepTrace), compare_paths);  // Stable output order whatever readdir returns
+        return 0;
+    }
+
+    FILE *manifest = fopen(source, "r");
+    char line[PATH_MAX];
+    if (manifest == NULL) {
+        perror(source);
+        return -1;
+    }
+    const char *slash = strrchr(source, '/');
+    int dir_len = slash != NULL ? (int) (slash - source) : 0;        // Relative entries are relative to the manifest
+    while (fgets(line, sizeof(line), manifest) != NULL) {
+        char *start = line;
+        while (*start == ' ' || *start == '\t') {
+            start++;
+        }
+        char *end = start + strlen(start);
+        while (end > start && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) {
+            *--end = '\0';
+        }
+        if (*start == '\0' || *start == '#') {
+            continue;                                                // Blank line or comment
+        }
+        if (*start == '/' || dir_len == 0) {
+            add_trace(traces, count, &capacity, start);
+        } else {
+            snprintf(path, sizeof(path), "%.*s/%s", dir_len, source, start);
+            add_trace(traces, count, &capacity, path);
+        }
+    }
+    fclose(manifest);
+    return 0;
+}
+
+/***** OUTPUT *****/
+static void print_json_string(FILE *out, const char *str) {
+    fputc('"', out);
+    for (const char *p = str; *p != '\0'; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(out, "\\%c", *p);
+        } else if ((unsigned char) *p < 0x20) {
+            fprintf(out, "\\u%04x", (unsigned char) *p);
+        } else {
+            fputc(*p, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void print_sweep_results(FILE *out, const CompareJob jobs[], int job_count) {
+    bool first = true;
+
+    if (gSchedOptions.format == FORMAT_JSON) {
+        fprintf(out, "[\n");
+    } else {
+        fprintf(out, "trace,algorithm,quantum,processes,avg_waiting,avg_turnaround,avg_response,makespan\n");
+    }
+    for (int i = 0; i < job_count; i++) {
+        const CompareJob *job = &jobs[i];
+        int quantum = strcmp(job->algo, "RR") == 0 ? job->quantum : 0;
+        if (job->status != 0) {
+            fprintf(stderr, "Skipping %s: unknown scheduling algorithm '%s'\n", job->trace, job->algo);
+            continue;
+        }
+        if (gSchedOptions.format == FORMAT_JSON) {
+            fprintf(out, "%s  {\"trace\": ", first ? "" : ",\n");
+            print_json_string(out, job->trace);
+            fprintf(out, ", \"algorithm\": \"%s\", \"quantum\": %d, \"processes\": %d, \"avg_waiting\": %.4f, "
+                         "\"avg_turnaround\": %.4f, \"avg_response\": %.4f, \"makespan\": %lld}",
+                    job->algo, quantum, job->n, job->avg_waiting, job->avg_turnaround, job->avg_response, job->makespan);
+        } else {
+            fprintf(out, "%s,%s,%d,%d,%.4f,%.4f,%.4f,%lld\n", job->trace, job->algo, quantum, job->n,
+                    job->avg_waiting, job->avg_turnaround, job->avg_response, job->makespan);
+        }
+        first = false;
+    }
+    if (gSchedOptions.format == FORMAT_JSON) {
+        fprintf(out, "%s]\n", first ? "" : "\n");
+    }
+}
+
+/***** SWEEP SCHEDULES *****/
+// Returns the process exit code: 0 when every trace loaded, EXIT_FAILURE otherwise
+int sweep_schedules(const char *source) {
+    SweepTrace *traces = NULL;
+    int trace_count = 0;
+    int failed = 0;
+
+    if (collect_traces(source, &traces, &trace_count) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    // Parse the algorithm list once: NULL means "whatever each trace names"
+    const char *algos[16];
+    int algo_count = 0;
+    char algo_list[256];
+    if (gSchedOptions.algos != NULL) {
+        snprintf(algo_list, sizeof(algo_list), "%s", gSchedOptions.algos);
+        for (char *tok = strtok(algo_list, ","); tok != NULL && algo_count < 16; tok = strtok(NULL, ",")) {
+            if (strcmp(tok, "all") == 0) {
+                for (int a = 0; a < 4 && algo_count < 16; a++) {
+                    algos[algo_count++] = sweep_algorithms[a];
+                }
+                continue;
+            }
+            int a = 0;
+            while (a < 4 && strcmp(tok, sweep_algorithms[a]) != 0) {
+                a++;
+            }
+            if (a == 4) {
+                fprintf(stderr, "Unknown algorithm '%s' in --algos\n", tok);
+                free(traces);
+                return EXIT_FAILURE;
+            }
+            algos[algo_count++] = sweep_algorithms[a];
+        }
+    }
+
+    int per_trace = (algo_count > 0 ? algo_count : 1) * (gSchedOptions.quantum_count > 0 ? gSchedOptions.quantum_count : 1);
+    CompareJob *jobs = malloc(((size_t) trace_count * per_trace + 1) * sizeof(CompareJob));
+    int job_count = 0;
+    if (jobs == NULL) {
+        perror("Unable to allocate the sweep jobs");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int t = 0; t < trace_count; t++) {
+        SweepTrace *trace = &traces[t];
+        if (load_trace(trace->path, &trace->procs, &trace->n, trace->algo, &trace->quantum) != 0) {
+            fprintf(stderr, "Skipping %s\n", trace->path);
+            failed++;
+            continue;
+        }
+
+        int count = algo_count > 0 ? algo_count : 1;
+        for (int a = 0; a < count; a++) {
+            const char *algo = algo_count > 0 ? algos[a] : trace->algo;
+            if (strcmp(algo, "RR") != 0) {
+                add_job(jobs, &job_count, trace->path, algo, 0, trace->procs, trace->n);
+            } else if (gSchedOptions.quantum_count > 0) {
+                for (int q = 0; q < gSchedOptions.quantum_count; q++) {
+                    add_job(jobs, &job_count, trace->path, algo, gSchedOptions.quanta[q], trace->procs, trace->n);
+                }
+            } else {
+                int quantum = strcmp(trace->algo, "RR") == 0 ? trace->quantum : DEFAULT_COMPARE_QUANTUM;
+                add_job(jobs, &job_count, trace->path, algo, quantum, trace->procs, trace->n);
+            }
+        }
+    }
+
+    run_job_pool(jobs, job_count, gSchedOptions.threads);
+
+    FILE *out = stdout;
+    if (gSchedOptions.output != NULL && (out = fopen(gSchedOptions.output, "w")) == NULL) {
+        perror(gSchedOptions.output);
+        out = stdout;
+        failed++;
+    }
+    print_sweep_results(out, jobs, job_count);
+    if (out != stdout) {
+        fclose(out);
+    }
+    fprintf(stderr, "Swept %d scenarios from %d traces%s\n", job_count, trace_count - failed, failed > 0 ? " (some failed, see above)" : "");
+
+    for (int t = 0; t < trace_count; t++) {
+        free(traces[t].procs);
+    }
+    free(traces);
+    free(jobs);
+    return failed == 0 ? 0 : EXIT_FAILURE;
+}
@@ -1,8 +1,118 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "scheduler.h"
 
+SchedOptions gSchedOptions = { LAYOUT_AOS, NULL, NULL, false, { 0 }, 0, 0, NULL, NULL, FORMAT_CSV, NULL, NULL, DEFAULT_STREAM_WINDOW, 0 };
+
+/***** OPTIONS *****/
+int parse_sched_option(const char* arg, SchedOptions* opts) {
+    if (strncmp(arg, "--layout=", 9) == 0) {
+        if (strcmp(arg + 9, "aos") == 0) {
+            opts->layout = LAYOUT_AOS;
+        } else if (strcmp(arg + 9, "soa") == 0) {
+            opts->layout = LAYOUT_SOA;
+        } else {
+            fprintf(stderr, "Unknown layout '%s' (expected aos or soa)\n", arg + 9);
+            return -1;
+        }
+        return 0;
+    }
+    if (strncmp(arg, "--write-binary=", 15) == 0) {
+        opts->write_binary = arg + 15;
+        return 0;
+    }
+    if (strcmp(arg, "--compare") == 0) {
+        opts->compare = true;
+        return 0;
+    }
+    if (strncmp(arg, "--quanta=", 9) == 0) {
+        const char *p = arg + 9;
+        opts->quantum_count = 0;
+        while (*p != '\0' && opts->quantum_count < MAX_COMPARE_QUANTA) {
+            int q = atoi(p);
+            if (q <= 0) {
+                fprintf(stderr, "Quanta must be positive integers, e.g. --quanta=2,4,8\n");
+                return -1;
+            }
+            opts->quanta[opts->quantum_count++] = q;
+            p = strchr(p, ',');
+            if (p == NULL) {
+                break;
+            }
+            p++;
+        }
+        return 0;
+    }
+    if (strncmp(arg, "--threads=", 10) == 0) {
+        opts->threads = atoi(arg + 10);
+        if (opts->threads <= 0) {
+            fprintf(stderr, "Thread count must be positive\n");
+            return -1;
+        }
+        return 0;
+    }
+    if (strncmp(arg, "--sweep=", 8) == 0) {
+        opts->sweep = arg + 8;
+        return 0;
+    }
+    if (strncmp(arg, "--algos=", 8) == 0) {
+        opts->algos = arg + 8;
+        return 0;
+    }
+    if (strncmp(arg, "--format=", 9) == 0) {
+        if (strcmp(arg + 9, "csv") == 0) {
+            opts->format = FORMAT_CSV;
+        } else if (strcmp(arg + 9, "json") == 0) {
+            opts->format = FORMAT_JSON;
+        } else {
+            fprintf(stderr, "Unknown format '%s' (expected csv or json)\n", arg + 9);
+            return -1;
+        }
+        return 0;
+    }
+    if (strncmp(arg, "--output=", 9) == 0) {
+        opts->output = arg + 9;
+        return 0;
+    }
+    if (strcmp(arg, "--stream") == 0) {
+        opts->stream = "-";                                          // Standard input
+        return 0;
+    }
+    if (strncmp(arg, "--stream=", 9) == 0) {
+        opts->stream = arg + 9;
+        return 0;
+    }
+    if (strncmp(arg, "--window=", 9) == 0) {
+        opts->window = atoi(arg + 9);
+        if (opts->window <= 0) {
+            fprintf(stderr, "Window must be a positive number of completions\n");
+            return -1;
+        }
+        return 0;
+    }
+    if (strcmp(arg, "--bench") == 0) {
+        opts->bench_max = DEFAULT_BENCH_MAX;
+        return 0;
+    }
+    if (strncmp(arg, "--bench=", 8) == 0) {
+        opts->bench_max = (int) strtod(arg + 8, NULL);               // Accepts 1e6 as well as 1000000
+        if (opts->bench_max < 1000) {
+            fprintf(stderr, "The largest benchmark trace must have at least 1000 processes\n");
+            return -1;
+        }
+        return 0;
+    }
+    if (strncmp(arg, "--", 2) != 0) {
+        opts->trace_path = arg;                                      // Anything that is not an option is the trace to load
+        return 0;
+    }
+
+    fprintf(stderr, "Unknown option '%s'\n", arg);
+    return -1;
+}
+
 /***** CALCULATE AVERAGE WAITING TIME *****/
 void calculate_waiting_average(Process procs[], int n) {
     double total_waiting_time = 0.0;                                 // Initialize total waiting time to zero
@@ -14,7 +124,7 @@ void calculate_waiting_average(Process procs[], int n) {
 }
 
 /***** CALCULATE WAITING TIME *****/
-void calculate_waiting_time(Process *proc, int current_time) {
+void calculate_waiting_time(Process *proc, sim_time_t current_time) {
     proc->waiting_time = current_time - proc->arrival_time - proc->cpu_burst_time;  // Calculate waiting time for a process
 }
 
@@ -23,7 +133,7 @@ void print_process_time_results(Process procs[], int n) {
     printf("      Process         Waiting (T)    Finish (T)\n");      // Print header for results
     printf("-------------------------------------------\n");          
     for (int i = 0; i < n; i++) {                                     
-        printf("%10d %15d %15d\n",                                    // Print process ID, waiting time, and finish time
+        printf("%10d %15lld %15lld\n",                                // Print process ID, waiting time, and finish time
                procs[i].process_number, procs[i].waiting_time, procs[i].finish_time);
     }
 }
@@ -33,7 +143,7 @@ void print_process_burst_times(Process procs[], int n) {
     printf("      Process       Burst (T)\n");                       // Print header for burst times
     printf("-----------------------------\n");                       
     for (int i = 0; i < n; i++) {                                    
-        printf("%10d %15d\n",                                        // Print process ID and CPU burst time
+        printf("%10d %15lld\n",                                      // Print process ID and CPU burst time
                procs[i].process_number, procs[i].cpu_burst_time);
     }
 }
@@ -43,6 +153,18 @@ void execute_schedule(const char* algo, Process* procs, int n, int quantum) {
     printf("\nExecuting %s scheduling...\n", algo);                  // Print the scheduling algorithm being executed
     print_process_burst_times(procs, n);                             // Print burst times of all processes
 
+    if (run_algorithm(algo, procs, n, quantum) != 0) {               // If the algorithm is not recognized
+        fprintf(stderr, "Invalid scheduling algorithm specified.\n");
+        exit(EXIT_FAILURE);                                          // Print error message and exit with failure
+    }
+
+    print_process_time_results(procs, n);                            // Print results for each process
+    calculate_waiting_average(procs, n);                             // Calculate and print the average waiting time
+}
+
+/***** RUN ALGORITHM *****/
+// Only fills in the per-process times, printing is left to the caller so several runs can go side by side
+int run_algorithm(const char* algo, Process* procs, int n, int quantum) {
     if (strcmp(algo, "RR") == 0) {                                   // If the algorithm is Round Robin
         round_robin(procs, n, quantum);                              // Execute Round Robin scheduling
     } else if (strcmp(algo, "SJF") == 0) {                           // If the algorithm is Shortest Job First
@@ -51,71 +173,52 @@ void execute_schedule(const char* algo, Process* procs, int n, int quantum) {
         pr_noPREMP(procs, n);                                        // Execute Non-Preemptive Priority scheduling
     } else if (strcmp(algo, "PR_withPREMP") == 0) {                  // If the algorithm is Preemptive Priority
         PR_PREMP(procs, n);                                          // Execute Preemptive Priority scheduling
-    } else {                                                         // If the algorithm is not recognized
-        fprintf(stderr, "Invalid scheduling algorithm specified.\n");
-        exit(EXIT_FAILURE);                                          // Print error message and exit with failure
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// Same names as run_algorithm(); the non-preemptive ones always use the ready heap, the SoA kernel needs the whole trace
+int run_algorithm_events(const char* algo, SimEngine* eng, int quantum) {
+    if (strcmp(algo, "RR") == 0) {
+        round_robin_events(eng, quantum);
+    } else if (strcmp(algo, "SJF") == 0) {
+        nonpreemptive_events(eng, shorter_burst);
+    } else if (strcmp(algo, "PR_noPREMP") == 0) {
+        nonpreemptive_events(eng, higher_priority);
+    } else if (strcmp(algo, "PR_withPREMP") == 0) {
+        preemptive_priority_events(eng);
+    } else {
+        return -1;
     }
+    return 0;
 }
 
 /***** INITIALIZE SCHEDULING *****/
-int initialize_scheduling(const char* filename_base, Process* procs, int* n, char* scheduling_algo, int* quantum) {
+int initialize_scheduling(const char* filename_base, Process** procs_out, int* n, char* scheduling_algo, int* quantum) {
     char filename[50];                                               // Buffer to store filename
-    FILE *file_ptr = NULL;                                           // File pointer initialized to NULL
+    const char *path = gSchedOptions.trace_path;                     // An explicit path skips the probing below
 
-    for (int file_index = -1; file_index < 100; file_index++) {      // Loop to attempt opening different formatted file names
+    for (int file_index = -1; path == NULL && file_index < 100; file_index++) {      // Loop to attempt finding different formatted file names
         if (file_index == -1) {
             snprintf(filename, sizeof(filename), "%s.txt", filename_base);  // Format filename for the base case
         } else {
             snprintf(filename, sizeof(filename), "%s%d.txt", filename_base, file_index);  // Format filename with numbers
         }
-        
-        file_ptr = fopen(filename, "r");                             // Attempt to open file
-        if (file_ptr) {                                              // If file opens successfully
-            printf("Opened %s successfully...\n", filename);         // Print success message
-            break;                                                   
+        if (access(filename, R_OK) == 0) {                           // Only check that it exists, load_trace opens it once
+            path = filename;
         }
     }
 
-    if (!file_ptr) {                                                // If file was not opened successfully
+    if (path == NULL) {                                              // If no file was found
         perror("Error opening any input file, cannot proceed...");  // Print error message using perror
         return -1;                                                  // Return failure code
     }
 
-    if (fscanf(file_ptr, "%s", scheduling_algo) != 1) {             // Attempt to read scheduling algorithm from file
-        fprintf(stderr, "Failed to read scheduling algorithm\n");   // Print failure message
-        fclose(file_ptr);                                           
-        return -1;                                                  // Return failure code
-    }
-
-    if (strcmp(scheduling_algo, "RR") == 0) {                       // If algorithm is Round Robin, read quantum value
-        if (fscanf(file_ptr, "%d", quantum) != 1) {
-            fprintf(stderr, "Failed to read quantum for RR\n");     // Print failure message
-            fclose(file_ptr);                                       
-            return -1;                                              // Return failure code
-        }
-    }
-
-    if (fscanf(file_ptr, "%d", n) != 1) {                           // Attempt to read number of processes
-        fprintf(stderr, "Failed to read number of processes\n");    // Print failure message
-        fclose(file_ptr);                                           
-        return -1;                                                  // Return failure code
-    }
-
-    for (int i = 0; i < *n; i++) {                                  // Loop to read data for each process
-        if (fscanf(file_ptr, "%d %d %d %d",                         // Attempt to read process data
-                   &procs[i].process_number,
-                   &procs[i].arrival_time,
-                   &procs[i].cpu_burst_time,
-                   &procs[i].priority) != 4) {
-            fprintf(stderr, "Failed to read data for process %d\n", i);  // Print failure message
-            fclose(file_ptr);                                            
-            return -1;                                                   // Return failure code
-        }
-        procs[i].remaining_time = procs[i].cpu_burst_time;               // Set remaining time equal to CPU burst time
-        procs[i].has_started = false;                                    // Mark process as not started
-        procs[i].start_time = procs[i].finish_time = procs[i].response_time = procs[i].waiting_time = procs[i].last_execution_time = 0;  // Initialize all timing data
+    if (load_trace(path, procs_out, n, scheduling_algo, quantum) != 0) {
+        return -1;                                                  // load_trace printed the reason
     }
-
-    fclose(file_ptr);                                                    // Close file after reading data
-    return 0;                                                            // Return success code
+    printf("Opened %s successfully...\n", path);                    // Print success message
+    return 0;                                                       // Return success code
 }
@@ -0,0 +1,95 @@
+/*
+CSC139
+Spring 2024
+Second Assignment: synthetic trace generator
+Delgado, Eric
+Section #03
+OSs Tested on: Linux Only
+*/
+
+/*
+* Writes a trace cpu_scheduling can load: the text format by default, or the binary format (--binary) for large runs.
+* Build with: gcc -O2 -o trace_gen trace_gen.c -lm
+* Example: ./trace_gen --count=100000 --arrival=bursty --burst=pareto --algo=RR --quantum=4 --out=big.txt
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include "scheduler.h"
+#include "scheduler_loader_utils.h"
+#include "trace_gen.h"
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--count=N] [--arrival=poisson|bursty] [--interarrival=T] [--group=N]\n"
+                    "       [--burst=exp|pareto] [--mean-burst=T] [--alpha=A] [--max-burst=T] [--priorities=min:max] [--seed=S]\n"
+                    "       [--algo=RR|SJF|PR_noPREMP|PR_withPREMP] [--quantum=Q] [--binary] [--out=file]\n", prog);
+}
+
+/****** MAIN ******/
+int main(int argc, char *argv[]) {
+    TraceGenConfig cfg = TRACE_GEN_DEFAULTS;
+    const char *algo = "SJF";
+    int quantum = DEFAULT_COMPARE_QUANTUM;
+    const char *out_path = NULL;                                     // stdout
+    bool binary = false;
+
+    for (int i = 1; i < argc; i++) {
+        int rc = trace_gen_parse_option(argv[i], &cfg);
+        if (rc == 0) {
+            continue;
+        }
+        if (rc == 1 && strncmp(argv[i], "--algo=", 7) == 0) {
+            algo = argv[i] + 7;
+        } else if (rc == 1 && strncmp(argv[i], "--quantum=", 10) == 0 && atoi(argv[i] + 10) > 0) {
+            quantum = atoi(argv[i] + 10);
+        } else if (rc == 1 && strcmp(argv[i], "--binary") == 0) {
+            binary = true;
+        } else if (rc == 1 && strncmp(argv[i], "--out=", 6) == 0) {
+            out_path = argv[i] + 6;
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (binary && out_path == NULL) {
+        fprintf(stderr, "--binary needs --out=file\n");
+        return EXIT_FAILURE;
+    }
+
+    Process *procs = malloc((size_t) cfg.count * sizeof(Process));
+    if (procs == NULL) {
+        perror("Unable to allocate the processes");
+        return EXIT_FAILURE;
+    }
+    generate_trace(&cfg, procs, cfg.count);
+
+    int rc = 0;
+    if (binary) {
+        rc = write_binary_trace(out_path, procs, cfg.count, algo, quantum);
+    } else {
+        FILE *out = out_path != NULL ? fopen(out_path, "w") : stdout;
+        if (out == NULL) {
+            perror(out_path);
+            free(procs);
+            return EXIT_FAILURE;
+        }
+        if (strcmp(algo, "RR") == 0) {
+            fprintf(out, "RR %d\n", quantum);
+        } else {
+            fprintf(out, "%s\n", algo);
+        }
+        fprintf(out, "%d\n", cfg.count);
+        for (int i = 0; i < cfg.count; i++) {
+            fprintf(out, "%d %lld %lld %d\n", procs[i].process_number, procs[i].arrival_time, procs[i].cpu_burst_time, procs[i].priority);
+        }
+        if (out != stdout && fclose(out) != 0) {
+            perror(out_path);
+            rc = -1;
+        }
+    }
+    free(procs);
+    return rc == 0 ? 0 : EXIT_FAILURE;
+}
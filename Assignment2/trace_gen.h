@@ -0,0 +1,178 @@
+#ifndef TRACE_GEN_H
+#define TRACE_GEN_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "scheduler.h"
+
+/*
+* Synthetic workload generator, shared by trace_gen.c and --bench
+* Arrivals are a Poisson process or bursts of simultaneous arrivals with the same average rate, bursts are
+* exponential or Pareto (heavy-tailed), priorities uniform. The same seed gives the same trace.
+*/
+
+typedef enum {
+    ARRIVAL_POISSON,            // Exponential gaps between single arrivals
+    ARRIVAL_BURSTY              // Groups of arrivals at one tick, exponential gaps between groups
+} ArrivalDist;
+
+typedef enum {
+    BURST_EXPONENTIAL,
+    BURST_PARETO                // Heavy-tailed: many short jobs, a few very long ones
+} BurstDist;
+
+struct TraceGenConfig {
+    int count;                  // Processes to generate
+    ArrivalDist arrival;
+    double mean_interarrival;   // Ticks between arrivals on average, whatever the distribution
+    double mean_group;          // Bursty only: average arrivals per group (geometric)
+    BurstDist burst;
+    double mean_burst;          // Average CPU burst in ticks
+    double alpha;               // Pareto shape, > 1 for a finite mean
+    sim_time_t max_burst;       // Bursts are clipped to [1, max_burst]
+    int priority_min, priority_max;
+    uint64_t seed;
+};
+
+// Offered load mean_burst / mean_interarrival = 0.8: queues build up and drain without growing forever
+#define TRACE_GEN_DEFAULTS { 1000, ARRIVAL_POISSON, 10.0, 8.0, BURST_EXPONENTIAL, 8.0, 1.5, 1000000, 1, 10, 1 }
+
+/***** RANDOM NUMBERS *****/
+// splitmix64: one 64-bit word of state, plenty for workload shapes
+static inline uint64_t gen_next(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in (0, 1], never 0 so log() stays finite
+static inline double gen_uniform(uint64_t *state) {
+    return ((gen_next(state) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+static inline double gen_exponential(uint64_t *state, double mean) {
+    return -mean * log(gen_uniform(state));
+}
+
+static inline double gen_pareto(uint64_t *state, double mean, double alpha) {
+    double scale = mean * (alpha - 1.0) / alpha;                     // Minimum value giving the requested mean
+    return scale / pow(gen_uniform(state), 1.0 / alpha);
+}
+
+/***** OPTIONS *****/
+// Returns 0 for a valid generator option, -1 for an invalid one, 1 if arg is not a generator option at all
+static int trace_gen_parse_option(const char *arg, TraceGenConfig *cfg) {
+    if (strncmp(arg, "--count=", 8) == 0) {
+        cfg->count = atoi(arg + 8);
+        if (cfg->count <= 0) {
+            fprintf(stderr, "Process count must be positive\n");
+            return -1;
+        }
+        return 0;
+    }
+    if (strncmp(arg, "--arrival=", 10) == 0) {
+        if (strcmp(arg + 10, "poisson") == 0) {
+            cfg->arrival = ARRIVAL_POISSON;
+        } else if (strcmp(arg + 10, "bursty") == 0) {
+            cfg->arrival = ARRIVAL_BURSTY;
+        } else {
+            fprintf(stderr, "Unknown arrival distribution '%s' (expected poisson or bursty)\n", arg + 10);
+            return -1;
+        }
+        return 0;
+    }
+    if (strncmp(arg, "--burst=", 8) == 0) {
+        if (strcmp(arg + 8, "exp") == 0) {
+            cfg->burst = BURST_EXPONENTIAL;
+        } else if (strcmp(arg + 8, "pareto") == 0) {
+            cfg->burst = BURST_PARETO;
+        } else {
+            fprintf(stderr, "Unknown burst distribution '%s' (expected exp or pareto)\n", arg + 8);
+            return -1;
+        }
+        return 0;
+    }
+    if (strncmp(arg, "--interarrival=", 15) == 0 || strncmp(arg, "--group=", 8) == 0 ||
+        strncmp(arg, "--mean-burst=", 13) == 0 || strncmp(arg, "--alpha=", 8) == 0) {
+        const char *eq = strchr(arg, '=');
+        double val = atof(eq + 1);
+        if (val <= 0.0) {
+            fprintf(stderr, "%.*s must be positive\n", (int) (eq - arg), arg);
+            return -1;
+        }
+        if (arg[2] == 'i') {
+            cfg->mean_interarrival = val;
+        } else if (arg[2] == 'g') {
+            cfg->mean_group = val < 1.0 ? 1.0 : val;
+        } else if (arg[2] == 'm') {
+            cfg->mean_burst = val;
+        } else if (val <= 1.0) {
+            fprintf(stderr, "Pareto alpha must be above 1 for the mean burst to exist\n");
+            return -1;
+        } else {
+            cfg->alpha = val;
+        }
+        return 0;
+    }
+    if (strncmp(arg, "--max-burst=", 12) == 0) {
+        cfg->max_burst = atoll(arg + 12);
+        if (cfg->max_burst <= 0) {
+            fprintf(stderr, "Maximum burst must be positive\n");
+            return -1;
+        }
+        return 0;
+    }
+    if (strncmp(arg, "--priorities=", 13) == 0) {
+        if (sscanf(arg + 13, "%d:%d", &cfg->priority_min, &cfg->priority_max) != 2 || cfg->priority_min > cfg->priority_max) {
+            fprintf(stderr, "Expected --priorities=min:max\n");
+            return -1;
+        }
+        return 0;
+    }
+    if (strncmp(arg, "--seed=", 7) == 0) {
+        cfg->seed = strtoull(arg + 7, NULL, 0);
+        return 0;
+    }
+    return 1;
+}
+
+/***** GENERATE *****/
+// Fill procs[0..count-1] in arrival order, numbered from 1
+static void generate_trace(const TraceGenConfig *cfg, Process procs[], int count) {
+    uint64_t state = cfg->seed;
+    double clock = 0.0;
+    int group_left = 0;                                              // Bursty: arrivals still to come at the current tick
+    uint32_t priority_range = (uint32_t) (cfg->priority_max - cfg->priority_min) + 1;
+
+    for (int i = 0; i < count; i++) {
+        Process *proc = &procs[i];
+        if (cfg->arrival == ARRIVAL_POISSON) {
+            clock += gen_exponential(&state, cfg->mean_interarrival);
+        } else if (group_left == 0) {
+            clock += gen_exponential(&state, cfg->mean_interarrival * cfg->mean_group);   // Same average rate as Poisson
+            group_left = 1;
+            while (gen_uniform(&state) > 1.0 / cfg->mean_group) {
+                group_left++;                                        // Geometric group size with mean mean_group
+            }
+        }
+        if (group_left > 0) {
+            group_left--;
+        }
+
+        double burst = cfg->burst == BURST_EXPONENTIAL ? gen_exponential(&state, cfg->mean_burst)
+                                                       : gen_pareto(&state, cfg->mean_burst, cfg->alpha);
+        proc->process_number = i + 1;
+        proc->arrival_time = (sim_time_t) clock;
+        proc->cpu_burst_time = burst < 1.0 ? 1 : burst > (double) cfg->max_burst ? cfg->max_burst : (sim_time_t) ceil(burst);
+        proc->priority = cfg->priority_min + (int) ((gen_next(&state) >> 32) % priority_range);
+        proc->remaining_time = proc->cpu_burst_time;
+        proc->has_started = false;
+        proc->start_time = proc->finish_time = proc->response_time = proc->waiting_time = proc->last_execution_time = 0;
+    }
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef FAST_RAND_H
+#define FAST_RAND_H
+
+#include <stdint.h>
+
+/*
+* xoshiro256** pseudo random number generator
+* Replaces rand() for the produced values of Assignment1 and the input array of Assignment 3: no lock, no hidden
+* global state, and a whole batch can be generated in one call. Every stream is fully determined by the seed passed
+* to RandSeed(), and RandJump() splits one seed into non-overlapping streams for producers or threads running side
+* by side.
+*/
+typedef struct {
+    uint64_t s[4];
+} RandState;
+
+static inline uint64_t RandRotl(uint64_t x, int k)
+{
+        return (x << k) | (x >> (64 - k));
+}
+
+// Expand a small seed into the 256-bit state with splitmix64, as recommended by the xoshiro authors
+static inline void RandSeed(RandState* st, uint64_t seed)
+{
+        for (int i = 0; i < 4; i++) {
+                uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                st->s[i] = z ^ (z >> 31);
+        }
+}
+
+static inline uint64_t RandNext(RandState* st)
+{
+        uint64_t* s = st->s;
+        uint64_t result = RandRotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = RandRotl(s[3], 45);
+        return result;
+}
+
+// Advance the stream by 2^128 values, the same as that many RandNext() calls
+static inline void RandJump(RandState* st)
+{
+        static const uint64_t jump[4] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+        uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+
+        for (int i = 0; i < 4; i++) {
+                for (int b = 0; b < 64; b++) {
+                        if (jump[i] & (1ULL << b)) {
+                                s0 ^= st->s[0];
+                                s1 ^= st->s[1];
+                                s2 ^= st->s[2];
+                                s3 ^= st->s[3];
+                        }
+                        RandNext(st);
+                }
+        }
+        st->s[0] = s0;
+        st->s[1] = s1;
+        st->s[2] = s2;
+        st->s[3] = s3;
+}
+
+// Uniform value in [x, y] using Lemire's multiply-shift reduction instead of a modulo (unbiased, no division on the common path)
+static inline int RandRange(RandState* st, int x, int y)
+{
+        uint32_t range = (uint32_t) (y - x) + 1;
+        uint64_t m = (RandNext(st) >> 32) * range;
+        uint32_t low = (uint32_t) m;
+
+        if (low < range) {
+                uint32_t threshold = (0u - range) % range;
+                while (low < threshold) {
+                        m = (RandNext(st) >> 32) * range;
+                        low = (uint32_t) m;
+                }
+        }
+        return x + (int) (m >> 32);
+}
+
+// Fill out[0..n-1] with values in [x, y], same sequence as n RandRange() calls
+static inline void RandFill(RandState* st, int* out, int n, int x, int y)
+{
+        for (int i = 0; i < n; i++) {
+                out[i] = RandRange(st, x, y);
+        }
+}
+
+#endif